@@ -0,0 +1,518 @@
+#include "ob/parg.hh"
+using Parg = OB::Parg;
+
+#include "ob/text.hh"
+#include "ob/vterm.hh"
+
+#include "fltrdr/tui.hh"
+
+#include <cstdio>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+
+#include <new>
+#include <atomic>
+#include <chrono>
+#include <string>
+#include <string_view>
+#include <vector>
+#include <utility>
+#include <functional>
+#include <sstream>
+#include <fstream>
+#include <iostream>
+#include <iomanip>
+
+#include <filesystem>
+namespace fs = std::filesystem;
+
+// count every heap allocation made by the program
+static std::atomic<std::size_t> alloc_count {0};
+
+void* operator new(std::size_t size)
+{
+  ++alloc_count;
+
+  if (void* ptr = std::malloc(size ? size : 1))
+  {
+    return ptr;
+  }
+
+  throw std::bad_alloc();
+}
+
+void* operator new[](std::size_t size)
+{
+  return operator new(size);
+}
+
+void operator delete(void* ptr) noexcept
+{
+  std::free(ptr);
+}
+
+void operator delete[](void* ptr) noexcept
+{
+  std::free(ptr);
+}
+
+void operator delete(void* ptr, std::size_t) noexcept
+{
+  std::free(ptr);
+}
+
+void operator delete[](void* ptr, std::size_t) noexcept
+{
+  std::free(ptr);
+}
+
+// prototypes
+int program_options(Parg& pg);
+int bench_render(Parg& pg);
+int bench_text(Parg& pg);
+std::string corpus_make(std::string const& name, std::size_t const size);
+std::vector<std::size_t> sizes_parse(std::string const& str);
+
+int program_options(Parg& pg)
+{
+  pg.name("fltrdr_bench").version("0.3.1 (09.05.2019)");
+  pg.description("Headless rendering benchmark for fltrdr.");
+
+  pg.usage("[--suite render] [--width <n>] [--height <n>] [--wpm <n>] [--frames <n>] [--config|-u <file>] [--golden <file> [--update]] <file>");
+  pg.usage("--suite text [--sizes <list>] [--corpus <list>] [--min-time <ms>]");
+  pg.usage("[--help|-h]");
+
+  pg.info("Suites", {
+    "render\n    replay the corpus 'file' through the headless renderer",
+    "text\n    measure the OB::Text primitives on synthetic corpora:\n    str, find, rfind, find_first_of, substr, byte_to_char, colstr, normalize_foldcase",
+  });
+
+  pg.info("Corpora", {
+    "ascii\n    plain ascii words",
+    "latin\n    latin words with accents, precomposed and combining",
+    "cjk\n    wide chars",
+    "emoji\n    emoji zwj sequences and modifiers",
+    "mixed\n    all of the above interleaved",
+  });
+
+  pg.info("Output", {
+    "one JSON object per line on stdout",
+  });
+
+  pg.info("Golden Frames", {
+    "a digest of every rendered frame, including styles, and the final screen are\n    compared against 'file' given to '--golden', use '--update' to write it instead",
+  });
+
+  pg.info("Exit Codes", {"0 -> normal", "1 -> error or golden frame mismatch"});
+
+  pg.set("help,h", "Print the help output.");
+  pg.set("update", "Write the golden file instead of comparing against it.");
+
+  pg.set("suite", "render", "name", "Benchmark suite to run, 'render' or 'text'.");
+  pg.set("sizes", "16,1K,64K,1M", "list", "Comma separated text sizes in bytes, with an optional K or M suffix.\n    Sizes up to 100M are supported.");
+  pg.set("corpus", "ascii,latin,cjk,emoji,mixed", "list", "Comma separated synthetic corpora for the text suite.");
+  pg.set("min-time", "200", "ms", "Minimum time to run each text benchmark for.");
+  pg.set("width", "80", "n", "Width of the virtual terminal.");
+  pg.set("height", "24", "n", "Height of the virtual terminal.");
+  pg.set("wpm", "250", "n", "Words per minute to replay the corpus at.");
+  pg.set("frames", "0", "n", "Stop after 'n' frames, 0 replays the whole corpus.");
+  pg.set("config,u", "NONE", "file", "Use the commands in the config file 'file' for initialization.");
+  pg.set("golden", "", "file", "Compare the rendered frames against the golden file 'file'.");
+
+  pg.set_pos();
+
+  int status {pg.parse()};
+
+  if (status < 0)
+  {
+    std::cerr << "Usage:\n" << pg.usage() << "\n";
+    std::cerr << "Error: " << pg.error() << "\n";
+
+    return -1;
+  }
+
+  if (pg.get<bool>("help"))
+  {
+    std::cout << pg.help();
+
+    return 1;
+  }
+
+  if (pg.get<std::string>("suite") != "render" && pg.get<std::string>("suite") != "text")
+  {
+    std::cerr << "Usage:\n" << pg.usage() << "\n";
+    std::cerr << "Error: unknown suite '" << pg.get<std::string>("suite") << "'\n";
+
+    return -1;
+  }
+
+  if (pg.get<std::string>("suite") == "render" && pg.get_pos_vec().empty())
+  {
+    std::cerr << "Usage:\n" << pg.usage() << "\n";
+    std::cerr << "Error: missing corpus file\n";
+
+    return -1;
+  }
+
+  return 0;
+}
+
+int bench_render(Parg& pg)
+{
+  auto const corpus = pg.get_pos_vec().at(0);
+  auto const width = pg.get<std::size_t>("width");
+  auto const height = pg.get<std::size_t>("height");
+  auto const wpm = pg.get<int>("wpm");
+  auto const frames_max = pg.get<std::size_t>("frames");
+
+  OB::VTerm vterm {width, height};
+  Tui tui {vterm};
+
+  tui.init(corpus);
+  tui.load_config(pg.get<fs::path>("config"));
+  tui.command("wpm " + std::to_string(wpm));
+
+  // running digest of every frame
+  std::uint64_t digest {0xcbf29ce484222325};
+
+  std::size_t frames {0};
+  std::chrono::microseconds scheduled {0};
+
+  auto const alloc_begin = alloc_count.load();
+  auto const bytes_begin = vterm.bytes();
+  auto const time_begin = std::chrono::steady_clock::now();
+
+  while (frames_max == 0 || frames < frames_max)
+  {
+    auto const wait = tui.step();
+
+    if (wait == wait.zero())
+    {
+      break;
+    }
+
+    ++frames;
+    scheduled += wait;
+
+    digest ^= vterm.hash();
+    digest *= 0x100000001b3;
+  }
+
+  auto const time_end = std::chrono::steady_clock::now();
+  auto const allocs = alloc_count.load() - alloc_begin;
+  auto const bytes = vterm.bytes() - bytes_begin;
+
+  auto const seconds = std::chrono::duration<double>(time_end - time_begin).count();
+  auto const per_frame = [&](double const val) {
+    return frames ? val / static_cast<double>(frames) : 0.0;
+  };
+
+  std::ostringstream hex;
+  hex << std::hex << std::setw(16) << std::setfill('0') << digest;
+
+  // compare against or write the golden file
+  std::string golden {"none"};
+
+  if (auto const path = pg.get<fs::path>("golden"); ! path.empty())
+  {
+    auto const expected = hex.str() + "\n" + vterm.str();
+
+    if (pg.get<bool>("update"))
+    {
+      std::ofstream file {path, std::ios::trunc};
+
+      if (! file.is_open())
+      {
+        throw std::runtime_error("could not open the file '" + path.string() + "'");
+      }
+
+      file << expected;
+      golden = "written";
+    }
+    else
+    {
+      std::ifstream file {path};
+
+      if (! file.is_open())
+      {
+        throw std::runtime_error("could not open the file '" + path.string() + "'");
+      }
+
+      std::ostringstream actual;
+      actual << file.rdbuf();
+      golden = actual.str() == expected ? "match" : "mismatch";
+    }
+  }
+
+  std::cout
+  << std::fixed << std::setprecision(3)
+  << "{\"bench\":\"render\""
+  << ",\"corpus\":\"" << corpus << "\""
+  << ",\"width\":" << width
+  << ",\"height\":" << height
+  << ",\"wpm\":" << wpm
+  << ",\"frames\":" << frames
+  << ",\"seconds\":" << seconds
+  << ",\"fps\":" << (seconds > 0 ? static_cast<double>(frames) / seconds : 0.0)
+  << ",\"allocs_per_frame\":" << per_frame(static_cast<double>(allocs))
+  << ",\"bytes_per_frame\":" << per_frame(static_cast<double>(bytes))
+  << ",\"realtime\":" << (seconds > 0 ? std::chrono::duration<double>(scheduled).count() / seconds : 0.0)
+  << ",\"digest\":\"" << hex.str() << "\""
+  << ",\"golden\":\"" << golden << "\""
+  << "}\n";
+
+  return golden == "mismatch" ? 1 : 0;
+}
+
+std::vector<std::size_t> sizes_parse(std::string const& str)
+{
+  std::vector<std::size_t> res;
+  std::istringstream ss {str};
+  std::string tok;
+
+  while (std::getline(ss, tok, ','))
+  {
+    if (tok.empty())
+    {
+      continue;
+    }
+
+    std::size_t mul {1};
+
+    if (tok.back() == 'K' || tok.back() == 'k')
+    {
+      mul = 1024;
+      tok.pop_back();
+    }
+    else if (tok.back() == 'M' || tok.back() == 'm')
+    {
+      mul = 1024 * 1024;
+      tok.pop_back();
+    }
+
+    res.emplace_back(std::stoul(tok) * mul);
+  }
+
+  return res;
+}
+
+std::string corpus_make(std::string const& name, std::size_t const size)
+{
+  // words are repeated until the corpus reaches the requested size,
+  // cut at a word boundary so that no sequence is split
+  std::vector<std::string> words;
+
+  std::vector<std::string> const ascii {"the", "quick", "brown", "fox", "jumps",
+    "over", "the", "lazy", "dog,", "and", "then", "reads", "another", "sentence."};
+
+  std::vector<std::string> const latin {"café", "naïve", "résumé", "über",
+    "façade", "déjà-vu", "crème", "brûlée", "señor", "cœur", "e\u0301te\u0301,"};
+
+  std::vector<std::string> const cjk {"日本語", "の", "文章", "を", "速く",
+    "読む", "中文", "阅读", "速度", "한국어", "문장。"};
+
+  std::vector<std::string> const emoji {"👩\u200d👩\u200d👧\u200d👦",
+    "👨🏽\u200d💻", "🏳️\u200d🌈", "🧑\u200d🚀", "👍🏿", "🇯🇵", "❤️"};
+
+  if (name == "ascii")
+  {
+    words = ascii;
+  }
+  else if (name == "latin")
+  {
+    words = latin;
+  }
+  else if (name == "cjk")
+  {
+    words = cjk;
+  }
+  else if (name == "emoji")
+  {
+    words = emoji;
+  }
+  else if (name == "mixed")
+  {
+    for (std::size_t i = 0; i < 7; ++i)
+    {
+      words.emplace_back(ascii.at(i));
+      words.emplace_back(latin.at(i));
+      words.emplace_back(cjk.at(i));
+      words.emplace_back(emoji.at(i));
+    }
+  }
+  else
+  {
+    throw std::runtime_error("unknown corpus '" + name + "'");
+  }
+
+  std::string res;
+  res.reserve(size + 32);
+
+  for (std::size_t i = 0; res.size() < size; ++i)
+  {
+    auto const& word = words.at(i % words.size());
+
+    if (! res.empty() && res.size() + word.size() + 1 > size)
+    {
+      break;
+    }
+
+    if (! res.empty())
+    {
+      res += " ";
+    }
+
+    res += word;
+  }
+
+  return res;
+}
+
+int bench_text(Parg& pg)
+{
+  auto const sizes = sizes_parse(pg.get<std::string>("sizes"));
+  auto const min_time = std::chrono::milliseconds(pg.get<int>("min-time"));
+
+  std::vector<std::string> corpora;
+  {
+    std::istringstream ss {pg.get<std::string>("corpus")};
+    std::string tok;
+
+    while (std::getline(ss, tok, ','))
+    {
+      if (! tok.empty())
+      {
+        corpora.emplace_back(tok);
+      }
+    }
+  }
+
+  // keeps the results observable so the calls are not optimised away
+  std::size_t volatile sink {0};
+
+  // run op until min_time has passed, doubling the batch size each round
+  auto const run = [&](std::string const& op, std::string const& corpus,
+    std::size_t const bytes, std::function<std::size_t()> const& fn)
+  {
+    std::size_t iterations {0};
+    std::size_t batch {1};
+    std::size_t allocs {0};
+    std::chrono::steady_clock::duration elapsed {};
+
+    while (elapsed < min_time)
+    {
+      auto const alloc_begin = alloc_count.load();
+      auto const time_begin = std::chrono::steady_clock::now();
+
+      for (std::size_t i = 0; i < batch; ++i)
+      {
+        sink = sink + fn();
+      }
+
+      elapsed += std::chrono::steady_clock::now() - time_begin;
+      allocs += alloc_count.load() - alloc_begin;
+      iterations += batch;
+      batch *= 2;
+    }
+
+    auto const ns = std::chrono::duration<double, std::nano>(elapsed).count();
+    auto const per_op = ns / static_cast<double>(iterations);
+
+    std::cout
+    << std::fixed << std::setprecision(3)
+    << "{\"bench\":\"text\""
+    << ",\"op\":\"" << op << "\""
+    << ",\"corpus\":\"" << corpus << "\""
+    << ",\"bytes\":" << bytes
+    << ",\"iterations\":" << iterations
+    << ",\"ns_per_op\":" << per_op
+    << ",\"mb_per_s\":" << (static_cast<double>(bytes) / (1024.0 * 1024.0)) / (per_op / 1e9)
+    << ",\"allocs_per_op\":" << static_cast<double>(allocs) / static_cast<double>(iterations)
+    << "}\n" << std::flush;
+  };
+
+  for (auto const& corpus : corpora)
+  {
+    for (auto const size : sizes)
+    {
+      auto const text = corpus_make(corpus, size);
+      auto const bytes = text.size();
+
+      OB::Text::View const view {text};
+      OB::Text::View const set {".!?"};
+      auto const mid = view.size() / 2;
+
+      run("str", corpus, bytes, [&]() {
+        OB::Text::View v;
+        v.str(text);
+        return v.size();
+      });
+
+      // the needle does not occur, so each call scans the whole text
+      run("find", corpus, bytes, [&]() {
+        return view.find("~");
+      });
+
+      run("rfind", corpus, bytes, [&]() {
+        return view.rfind("~");
+      });
+
+      run("find_first_of", corpus, bytes, [&]() {
+        return view.find_first_of(set);
+      });
+
+      run("substr", corpus, bytes, [&]() {
+        return view.substr(view.size() / 4, mid).size();
+      });
+
+      run("byte_to_char", corpus, bytes, [&]() {
+        return view.byte_to_char(bytes / 2);
+      });
+
+      run("colstr", corpus, bytes, [&]() {
+        return view.colstr(0, view.cols() / 2).size();
+      });
+
+      run("normalize_foldcase", corpus, bytes, [&]() {
+        return OB::Text::normalize_foldcase(text).size();
+      });
+    }
+  }
+
+  return 0;
+}
+
+int main(int argc, char *argv[])
+{
+  Parg pg {argc, argv};
+  int pstatus {program_options(pg)};
+  if (pstatus > 0) return 0;
+  if (pstatus < 0) return 1;
+
+  std::ios_base::sync_with_stdio(false);
+
+  try
+  {
+    if (pg.get<std::string>("suite") == "text")
+    {
+      return bench_text(pg);
+    }
+
+    return bench_render(pg);
+  }
+  catch(std::exception const& e)
+  {
+    std::cerr << "Error: " << e.what() << "\n";
+
+    return 1;
+  }
+  catch(...)
+  {
+    std::cerr << "Error: an unexpected error occurred\n";
+
+    return 1;
+  }
+
+  return 0;
+}
@@ -25,9 +25,57 @@ namespace aec = OB::Term::ANSI_Escape_Codes;
 #include <stdexcept>
 #include <iterator>
 #include <random>
+#include <limits>
+#include <unordered_map>
 
 using namespace std::string_literals;
 
+// words hashed together as one rolling window
+static std::size_t constexpr window_size {8};
+
+// a chunk ends where its last window hashes to zero under the mask,
+// giving chunks of about 32 words
+static std::uint64_t constexpr chunk_mask {31};
+
+// fingerprints kept as the sample of a text
+static std::size_t constexpr sketch_size {64};
+
+// word offsets of the windows saved around a position,
+// spread out so an edit near it leaves some of them intact
+static std::int64_t constexpr anchor_deltas[] {-256, -64, -16, 0, 16, 64, 256};
+
+// multiplier of the rolling hash, and its power over a whole window
+static std::uint64_t constexpr roll_base {0x100000001b3};
+
+static std::uint64_t constexpr roll_pow()
+{
+  std::uint64_t res {1};
+
+  for (std::size_t i = 0; i < window_size; ++i)
+  {
+    res *= roll_base;
+  }
+
+  return res;
+}
+
+static std::uint64_t mix(std::uint64_t val)
+{
+  val ^= val >> 30;
+  val *= 0xbf58476d1ce4e5b9;
+  val ^= val >> 27;
+  val *= 0x94d049bb133111eb;
+  val ^= val >> 31;
+
+  return val;
+}
+
+// hash of the window ending at a word, given the hash of the one before it
+static std::uint64_t roll(std::uint64_t const hash, std::uint64_t const in, std::uint64_t const out)
+{
+  return hash * roll_base + in - out * roll_pow();
+}
+
 void Fltrdr::init()
 {
   _ctx.pos = 0;
@@ -36,6 +84,13 @@ void Fltrdr::init()
   _ctx.content_id.clear();
   _ctx.text.clear();
   _ctx.text.shrink_to_fit();
+  _ctx.words.clear();
+  _ctx.words.shrink_to_fit();
+  _ctx.freq.clear();
+  _ctx.freq_max = 0;
+  _ctx.hashes.clear();
+  _ctx.hashes.shrink_to_fit();
+  _ctx.prints.clear();
 
   reset_timer();
   reset_wpm_avg();
@@ -71,7 +126,7 @@ bool Fltrdr::parse(std::istream& input)
     ++word_count;
 
     _ctx.text.sync();
-    _ctx.index_max = word_count;
+    index_words();
     _ctx.content_id = OB::Crypto::sha256(_ctx.text.str()).value_or("");
 
     return false;
@@ -79,20 +134,281 @@ bool Fltrdr::parse(std::istream& input)
 
 
   _ctx.text.sync();
-  _ctx.index_max = word_count;
+  index_words();
   _ctx.content_id = OB::Crypto::sha256(_ctx.text.str()).value_or("");
 
   return true;
 }
 
+void Fltrdr::index_words()
+{
+  _ctx.words.clear();
+  _ctx.words.reserve(_ctx.index_max);
+
+  for (std::size_t i = 0; i < _ctx.text.size(); ++i)
+  {
+    // a space may form a single grapheme with a following combining mark
+    if (_ctx.text.at(i).str.front() == ' ')
+    {
+      _ctx.words.emplace_back(i);
+    }
+  }
+
+  _ctx.words.shrink_to_fit();
+  _ctx.index_max = _ctx.words.size();
+}
+
+void Fltrdr::set_chunk_size()
+{
+  _ctx.chunk_size = 1;
+
+  if (_ctx.chunk < 2 && _ctx.chunk_cols == 0)
+  {
+    return;
+  }
+
+  // a column budget takes as many words as fit, otherwise a word count
+  auto const max = _ctx.chunk_cols ? _ctx.words.size() : static_cast<std::size_t>(_ctx.chunk);
+
+  // keep the chunk within half the screen so the focus point can stay centred
+  auto cols = _ctx.width ? _ctx.width / 2 : std::numeric_limits<std::size_t>::max();
+
+  if (_ctx.chunk_cols && static_cast<std::size_t>(_ctx.chunk_cols) < cols)
+  {
+    cols = static_cast<std::size_t>(_ctx.chunk_cols);
+  }
+
+  auto const begin = _ctx.text.at(_ctx.pos + 1).tcols;
+
+  while (_ctx.chunk_size < max && _ctx.index + _ctx.chunk_size <= _ctx.index_max)
+  {
+    // display columns up to the end of the next word
+    auto const next = _ctx.index + _ctx.chunk_size;
+    auto const end = next < _ctx.words.size() ? _ctx.text.at(_ctx.words.at(next)).tcols : _ctx.text.cols();
+
+    if (end - begin > cols)
+    {
+      break;
+    }
+
+    ++_ctx.chunk_size;
+  }
+}
+
 std::string Fltrdr::content_id()
 {
   return _ctx.content_id;
 }
 
+void Fltrdr::index_hashes()
+{
+  if (! _ctx.hashes.empty())
+  {
+    return;
+  }
+
+  auto const& str = _ctx.text.str();
+  _ctx.hashes.reserve(_ctx.words.size());
+
+  for (std::size_t i = 0; i < _ctx.words.size(); ++i)
+  {
+    // fnv-1a over the bytes of the word without its leading space
+    auto const begin = _ctx.text.at(_ctx.words.at(i)).bytes + 1;
+    auto const end = i + 1 < _ctx.words.size() ? _ctx.text.at(_ctx.words.at(i + 1)).bytes : str.size();
+
+    std::uint64_t hash {0xcbf29ce484222325};
+
+    for (auto j = begin; j < end; ++j)
+    {
+      hash ^= static_cast<unsigned char>(str[j]);
+      hash *= 0x100000001b3;
+    }
+
+    _ctx.hashes.emplace_back(hash);
+  }
+}
+
+std::uint64_t Fltrdr::window(std::size_t const begin)
+{
+  std::uint64_t res {0};
+
+  for (std::size_t i = begin; i < begin + window_size; ++i)
+  {
+    res = roll(res, _ctx.hashes.at(i), 0);
+  }
+
+  return res;
+}
+
+std::vector<std::uint64_t> const& Fltrdr::fingerprints()
+{
+  if (! _ctx.prints.empty())
+  {
+    return _ctx.prints;
+  }
+
+  index_hashes();
+
+  auto const& hashes = _ctx.hashes;
+  std::vector<std::uint64_t> chunks;
+
+  std::uint64_t hash {0};
+  std::uint64_t print {0};
+  std::size_t size {0};
+
+  for (std::size_t i = 0; i < hashes.size(); ++i)
+  {
+    hash = roll(hash, hashes[i], i >= window_size ? hashes[i - window_size] : 0);
+    print = mix(print ^ hashes[i]);
+    ++size;
+
+    // cuts depend only on the words before them,
+    // so an edit moves at most the cuts around it
+    if (i + 1 == hashes.size() || (size >= window_size && (mix(hash) & chunk_mask) == 0))
+    {
+      chunks.emplace_back(print);
+      print = 0;
+      size = 0;
+    }
+  }
+
+  // the smallest hashes are a uniform sample that any two texts agree on
+  std::sort(chunks.begin(), chunks.end());
+  chunks.erase(std::unique(chunks.begin(), chunks.end()), chunks.end());
+
+  if (chunks.size() > sketch_size)
+  {
+    chunks.resize(sketch_size);
+  }
+
+  _ctx.prints = std::move(chunks);
+
+  return _ctx.prints;
+}
+
+double Fltrdr::similarity(std::vector<std::uint64_t> const& lhs, std::vector<std::uint64_t> const& rhs)
+{
+  // estimate of the jaccard index from the smallest hashes of the union
+  auto const size = std::min(lhs.size(), rhs.size());
+
+  std::size_t i {0};
+  std::size_t j {0};
+  std::size_t seen {0};
+  std::size_t both {0};
+
+  while (seen < size && i < lhs.size() && j < rhs.size())
+  {
+    if (lhs[i] == rhs[j])
+    {
+      ++both;
+      ++i;
+      ++j;
+    }
+    else if (lhs[i] < rhs[j])
+    {
+      ++i;
+    }
+    else
+    {
+      ++j;
+    }
+
+    ++seen;
+  }
+
+  return seen ? static_cast<double>(both) / static_cast<double>(seen) : 0.0;
+}
+
+Fltrdr::Anchors Fltrdr::anchors()
+{
+  index_hashes();
+
+  Anchors res;
+  auto const begin = static_cast<std::int64_t>(_ctx.index - 1);
+
+  // last position a whole window fits at
+  auto const limit = static_cast<std::int64_t>(_ctx.hashes.size()) - static_cast<std::int64_t>(window_size);
+
+  for (auto const delta : anchor_deltas)
+  {
+    auto const pos = begin + delta;
+
+    if (pos < 0 || pos > limit)
+    {
+      continue;
+    }
+
+    res.emplace_back(delta, window(static_cast<std::size_t>(pos)));
+  }
+
+  return res;
+}
+
+bool Fltrdr::relocate(Anchors const& anchors, std::size_t const index)
+{
+  index_hashes();
+
+  auto const& hashes = _ctx.hashes;
+
+  if (anchors.empty() || hashes.size() < window_size)
+  {
+    return false;
+  }
+
+  // one pass over every window, each matching anchor votes for the word it was saved around
+  std::unordered_map<std::size_t, std::size_t> votes;
+  std::uint64_t hash {0};
+
+  for (std::size_t i = 0; i < hashes.size(); ++i)
+  {
+    hash = roll(hash, hashes[i], i >= window_size ? hashes[i - window_size] : 0);
+
+    if (i + 1 < window_size)
+    {
+      continue;
+    }
+
+    auto const begin = static_cast<std::int64_t>(i + 1 - window_size);
+
+    for (auto const& [delta, val] : anchors)
+    {
+      auto const pos = begin - delta;
+
+      if (val == hash && pos >= 0 && pos < static_cast<std::int64_t>(hashes.size()))
+      {
+        ++votes[static_cast<std::size_t>(pos)];
+      }
+    }
+  }
+
+  if (votes.empty())
+  {
+    return false;
+  }
+
+  // most votes, then closest to the old index
+  auto const dist = [&](std::size_t const pos) {
+    return pos + 1 > index ? pos + 1 - index : index - pos - 1;
+  };
+
+  auto best = votes.begin();
+
+  for (auto it = votes.begin(); it != votes.end(); ++it)
+  {
+    if (it->second > best->second || (it->second == best->second && dist(it->first) < dist(best->first)))
+    {
+      best = it;
+    }
+  }
+
+  set_index(best->first + 1);
+
+  return true;
+}
+
 bool Fltrdr::eof()
 {
-  return _ctx.index >= _ctx.index_max;
+  return _ctx.index + _ctx.chunk_size - 1 >= _ctx.index_max;
 }
 
 void Fltrdr::begin()
@@ -128,40 +444,19 @@ OB::Text::View Fltrdr::buf_prev(std::size_t offset)
     return {};
   }
 
-  auto pos = _ctx.pos + 1;
-  auto count = size;
-
-  while (pos && count)
-  {
-    --pos;
-    --count;
-  }
-
-  size = size - count;
+  // clamp the window to the start of the text
+  size = static_cast<int>(std::min(_ctx.pos + 1, static_cast<std::size_t>(size)));
 
-  if (size < 1)
-  {
-    return {};
-  }
-
-  auto const min = pos;
+  auto const min = _ctx.pos + 1 - static_cast<std::size_t>(size);
 
   if (_ctx.show_line)
   {
     return _ctx.text.substr(min, static_cast<std::size_t>(size));
   }
 
-  pos = _ctx.pos;
-
-  for (int i = 0; i < _ctx.show_prev; ++i)
-  {
-    pos = _ctx.text.rfind(" "s, static_cast<std::size_t>(--pos));
-
-    if (pos <= min || pos == OB::Text::String::npos || pos == 0)
-    {
-      break;
-    }
-  }
+  // leading space of the first visible previous word
+  auto const show = static_cast<std::size_t>(_ctx.show_prev);
+  auto const pos = _ctx.words.at((_ctx.index > show ? _ctx.index - show : _ctx.index_min) - 1);
 
   auto const start = pos < min ? min : pos;
   auto const len = _ctx.pos + 1 - start < static_cast<std::size_t>(size) ?
@@ -172,16 +467,18 @@ OB::Text::View Fltrdr::buf_prev(std::size_t offset)
 
 OB::Text::View Fltrdr::buf_next(std::size_t offset)
 {
-  auto pos = _ctx.text.find(" "s, static_cast<std::size_t>(_ctx.pos + 1));
-  auto const start = pos;
+  // the word after the current chunk
+  auto const index = _ctx.index + _ctx.chunk_size - 1;
 
-  if (pos == OB::Text::String::npos)
+  if (index >= _ctx.words.size())
   {
     return {};
   }
 
+  auto const start = _ctx.words.at(index);
+
   auto const width = (_ctx.width / 2) + 1 + offset;
-  auto size = static_cast<int>(width - (_ctx.word.size() - _ctx.prefix_width));
+  auto size = static_cast<int>(width - (shown().size() - _ctx.prefix_width));
 
   if (size < 1)
   {
@@ -193,42 +490,34 @@ OB::Text::View Fltrdr::buf_next(std::size_t offset)
     ++size;
   }
 
-  auto p = pos;
-  auto count = size;
-
-  while (++count != size && ++p != _ctx.text.size() - 1);
-
   auto const max = static_cast<std::size_t>(size);
 
   if (_ctx.show_line)
   {
-    return _ctx.text.substr(pos, max);
+    return _ctx.text.substr(start, max);
   }
 
-  for (int i = 0; i < _ctx.show_next; ++i)
-  {
-    pos = _ctx.text.find(" "s, ++pos);
-
-    if (pos - start + 1 >= max || pos == OB::Text::String::npos)
-    {
-      pos = _ctx.text.size() - 1;
-
-      break;
-    }
-  }
+  // leading space of the word after the last visible next word
+  auto const last = index + static_cast<std::size_t>(_ctx.show_next);
+  auto const pos = last < _ctx.words.size() ? _ctx.words.at(last) : _ctx.text.size() - 1;
 
   auto const end = pos - start + 1;
 
   return _ctx.text.substr(start, end < max ? end : max);
 }
 
-void Fltrdr::set_focus_point()
+OB::Text::View& Fltrdr::shown()
+{
+  return _ctx.chunk_size > 1 ? _ctx.chunk_view : _ctx.word;
+}
+
+void Fltrdr::set_focus_point(OB::Text::View& unit)
 {
   std::size_t begin {0};
-  std::size_t end {_ctx.word.size()};
+  std::size_t end {unit.size()};
 
   // check for punct at beginning of word
-  for (auto i = _ctx.word.begin(); i != _ctx.word.end(); ++i)
+  for (auto i = unit.begin(); i != unit.end(); ++i)
   {
     if (! OB::Text::is_punct(OB::Text::to_int32(i->str)))
     {
@@ -239,11 +528,11 @@ void Fltrdr::set_focus_point()
   }
 
   // check for punct at end of word
-  for (auto i = _ctx.word.rbegin(); i != _ctx.word.rend(); ++i)
+  for (auto i = unit.rbegin(); i != unit.rend(); ++i)
   {
     if (! OB::Text::is_punct(OB::Text::to_int32(i->str)))
     {
-      if (i->str == "s" && ++i != _ctx.word.rend() &&
+      if (i->str == "s" && ++i != unit.rend() &&
         OB::Text::is_punct(OB::Text::to_int32(i->str)))
       {
         end -= 2;
@@ -256,12 +545,13 @@ void Fltrdr::set_focus_point()
   }
 
   auto size {end - begin};
-  if (size > _ctx.word.size() || size == 0)
+  if (size > unit.size() || size == 0)
   {
-    size = _ctx.word.size();
+    size = unit.size();
   }
 
-  if (size < 13)
+  // a chunk is read in one fixation, so its focus point scales with its length
+  if (size < 13 || _ctx.chunk_size > 1)
   {
     _ctx.focus_point = std::round(size * _ctx.focus);
   }
@@ -270,13 +560,19 @@ void Fltrdr::set_focus_point()
     _ctx.focus_point = 3;
   }
 
-  if (_ctx.word.size() != size)
+  if (unit.size() != size)
   {
     _ctx.focus_point += begin;
   }
 
+  // never focus on the space between two words of a chunk
+  if (_ctx.focus_point + 1 < unit.size() && unit.at(_ctx.focus_point).str == " ")
+  {
+    ++_ctx.focus_point;
+  }
+
   // calc display columns needed up to focus point position
-  _ctx.prefix_width = _ctx.word.at(_ctx.focus_point).tcols;
+  _ctx.prefix_width = unit.at(_ctx.focus_point).tcols;
 }
 
 void Fltrdr::set_line(std::size_t offset)
@@ -286,7 +582,17 @@ void Fltrdr::set_line(std::size_t offset)
   _ctx.next.clear();
 
   current_word();
-  set_focus_point();
+
+  if (_ctx.chunk_size > 1)
+  {
+    // the chunk ends at the leading space of the word after its last one
+    auto const last = _ctx.index + _ctx.chunk_size - 1;
+    auto const end = last < _ctx.words.size() ? _ctx.words.at(last) : _ctx.text.size();
+
+    _ctx.chunk_view = _ctx.text.substr(_ctx.pos + 1, end - _ctx.pos - 1);
+  }
+
+  set_focus_point(shown());
 
   if (_ctx.show_line)
   {
@@ -310,7 +616,7 @@ void Fltrdr::set_line(std::size_t offset)
   auto const width_right = (_ctx.width / 2) + 1 + offset;
 
   auto pad_left {static_cast<int>(width_left - _ctx.prefix_width - _ctx.prev.size())};
-  auto pad_right {static_cast<int>(width_right - _ctx.word.size() + _ctx.prefix_width - _ctx.next.size())};
+  auto pad_right {static_cast<int>(width_right - shown().size() + _ctx.prefix_width - _ctx.next.size())};
 
   if (_ctx.width % 2 != 0)
   {
@@ -330,7 +636,7 @@ void Fltrdr::set_line(std::size_t offset)
 
   _ctx.line.prev = OB::String::repeat(static_cast<std::size_t>(pad_left), aec::space) + std::string(_ctx.prev.str());
 
-  _ctx.line.curr = _ctx.word;
+  _ctx.line.curr = shown();
 
   _ctx.line.next += std::string(_ctx.next.str()) + OB::String::repeat(static_cast<std::size_t>(pad_right), aec::space);
 }
@@ -427,15 +733,17 @@ OB::Text::View Fltrdr::word()
 
 void Fltrdr::current_word()
 {
-  auto const pos = _ctx.text.find(" "s, _ctx.pos + 1);
-  if (pos != OB::Text::String::npos)
+  // the word ends at the leading space of the next word
+  if (_ctx.index < _ctx.words.size())
   {
-    _ctx.word = _ctx.text.substr(_ctx.pos + 1, pos - _ctx.pos - 1);
+    _ctx.word = _ctx.text.substr(_ctx.pos + 1, _ctx.words.at(_ctx.index) - _ctx.pos - 1);
   }
   else
   {
     _ctx.word = _ctx.text.substr(_ctx.pos + 1);
   }
+
+  set_chunk_size();
 }
 
 bool Fltrdr::prev_word()
@@ -443,15 +751,10 @@ bool Fltrdr::prev_word()
   if (_ctx.index > _ctx.index_min)
   {
     --_ctx.index;
+    _ctx.pos = _ctx.words.at(_ctx.index - 1);
+    current_word();
 
-    auto const pos = _ctx.text.rfind(" "s, _ctx.pos - 1);
-    if (pos != OB::Text::String::npos)
-    {
-      _ctx.pos = pos;
-      current_word();
-
-      return true;
-    }
+    return true;
   }
 
   return false;
@@ -462,15 +765,27 @@ bool Fltrdr::next_word()
   if (_ctx.index < _ctx.index_max)
   {
     ++_ctx.index;
+    _ctx.pos = _ctx.words.at(_ctx.index - 1);
+    current_word();
 
-    auto const pos = _ctx.text.find(" "s, _ctx.pos + 1);
-    if (pos != OB::Text::String::npos)
-    {
-      _ctx.pos = pos;
-      current_word();
+    return true;
+  }
 
-      return true;
-    }
+  return false;
+}
+
+bool Fltrdr::next_chunk()
+{
+  if (_ctx.chunk_size == 1)
+  {
+    return next_word();
+  }
+
+  if (_ctx.index + _ctx.chunk_size <= _ctx.index_max)
+  {
+    set_index(_ctx.index + _ctx.chunk_size);
+
+    return true;
   }
 
   return false;
@@ -487,71 +802,189 @@ void Fltrdr::set_index(std::size_t i)
     i = _ctx.index_max;
   }
 
-  if (i < _ctx.index)
+  _ctx.index = i;
+  _ctx.pos = _ctx.words.at(_ctx.index - 1);
+  current_word();
+}
+
+std::size_t Fltrdr::get_index()
+{
+  return _ctx.index;
+}
+
+std::size_t Fltrdr::get_offset()
+{
+  // byte offset of the current word's leading space in the text
+  return _ctx.text.at(_ctx.pos).bytes;
+}
+
+std::chrono::microseconds Fltrdr::get_wait()
+{
+  // time per word at the set wpm
+  double const base = 60000000.0 / _ctx.wpm;
+  double scale {0};
+
+  if (_ctx.chunk_size > 1)
   {
-    while (i != _ctx.index)
+    // a chunk is shown for as long as its words would be one at a time
+    for (auto i = _ctx.index; i < _ctx.index + _ctx.chunk_size; ++i)
     {
-      prev_word();
+      auto const start = _ctx.words.at(i - 1);
+      auto const end = i < _ctx.words.size() ? _ctx.words.at(i) : _ctx.text.size();
+
+      scale += _ctx.timing(*this, _ctx.text.substr(start + 1, end - start - 1));
     }
   }
-  else if (i > _ctx.index)
+  else
   {
-    while (i != _ctx.index)
-    {
-      next_word();
-    }
+    scale = _ctx.timing(*this, _ctx.word);
   }
+
+  _ctx.wait = std::chrono::microseconds(static_cast<std::chrono::microseconds::rep>(
+    std::round(base * scale)));
+  _ctx.wait_words = _ctx.chunk_size;
+
+  return _ctx.wait;
 }
 
-std::size_t Fltrdr::get_index()
+void Fltrdr::set_timing(Timing const& timing, std::string const& name)
 {
-  return _ctx.index;
+  _ctx.timing = timing;
+  _ctx.timing_name = name;
+}
+
+bool Fltrdr::set_timing(std::string const& name)
+{
+  if (name == "flat")
+  {
+    set_timing(&Fltrdr::timing_flat, name);
+  }
+  else if (name == "length")
+  {
+    set_timing(&Fltrdr::timing_length, name);
+  }
+  else if (name == "punct")
+  {
+    set_timing(&Fltrdr::timing_punct, name);
+  }
+  else if (name == "freq")
+  {
+    set_timing(&Fltrdr::timing_freq, name);
+  }
+  else if (name == "default")
+  {
+    set_timing(&Fltrdr::timing_default, name);
+  }
+  else
+  {
+    return false;
+  }
+
+  return true;
 }
 
-int Fltrdr::get_wait()
+std::string Fltrdr::get_timing()
 {
-  bool punc {false};
+  return _ctx.timing_name;
+}
 
-  // check for punct at end of word
-  for (auto i = _ctx.word.rbegin(); i != _ctx.word.rend(); ++i)
+double Fltrdr::timing_flat(Fltrdr&, OB::Text::View const&)
+{
+  return 1.0;
+}
+
+double Fltrdr::timing_length(Fltrdr&, OB::Text::View const& word)
+{
+  // longer words take longer to read
+  return 1.0 + (static_cast<double>(word.size()) * 0.04);
+}
+
+double Fltrdr::timing_punct(Fltrdr&, OB::Text::View const& word)
+{
+  // pause on trailing punctuation, longer at the end of a sentence
+  double res {1.0};
+
+  for (auto i = word.size(); i-- > 0;)
   {
-    if (OB::Text::is_punct(OB::Text::to_int32(i->str)))
+    auto const ch = OB::Text::to_int32(word.at(i).str);
+
+    if (! OB::Text::is_punct(ch))
     {
-      switch (OB::Text::to_int32(i->str))
-      {
-        case U',': case U'.': case U';':
-        case U':': case U'?': case U'!':
-        case U'…':
-          punc = true;
-          break;
-        default:
-          break;
-      }
+      break;
+    }
 
-      if (punc)
-      {
+    switch (ch)
+    {
+      case U'.': case U'?': case U'!':
+      case U'…':
+        return 2.0;
+
+      case U',': case U';': case U':':
+        res = 1.5;
+        break;
+
+      default:
         break;
-      }
     }
-    else
+  }
+
+  return res;
+}
+
+double Fltrdr::timing_freq(Fltrdr& fltrdr, OB::Text::View const& word)
+{
+  auto& ctx = fltrdr._ctx;
+
+  if (ctx.freq.empty())
+  {
+    // count every word in the text once
+    for (std::size_t i = 0; i < ctx.words.size(); ++i)
     {
-      break;
+      auto const end = i + 1 < ctx.words.size() ? ctx.words.at(i + 1) : ctx.text.size();
+      auto const count = ++ctx.freq[word_key(ctx.text.substr(ctx.words.at(i) + 1, end - ctx.words.at(i) - 1))];
+
+      if (count > ctx.freq_max)
+      {
+        ctx.freq_max = count;
+      }
     }
   }
 
-  auto const wait_std = static_cast<int>((60000 / _ctx.wpm) * (1 + (_ctx.word.size() / 100 * 4.0)));
+  auto const it = ctx.freq.find(word_key(word));
 
-  // set ms
-  if (punc)
+  if (it == ctx.freq.end() || ctx.freq_max < 2)
   {
-    _ctx.ms = wait_std * 2;
+    return 1.0;
   }
-  else
+
+  // rare words take up to half as long again as the most common one
+  auto const rarity = 1.0 - (std::log(static_cast<double>(it->second)) / std::log(static_cast<double>(ctx.freq_max)));
+
+  return 1.0 + (0.5 * rarity);
+}
+
+double Fltrdr::timing_default(Fltrdr& fltrdr, OB::Text::View const& word)
+{
+  return timing_length(fltrdr, word) * timing_punct(fltrdr, word);
+}
+
+std::string Fltrdr::word_key(OB::Text::View const& word)
+{
+  // case folded with surrounding punctuation removed
+  std::size_t begin {0};
+  std::size_t end {word.size()};
+
+  while (begin < end && OB::Text::is_punct(OB::Text::to_int32(word.at(begin).str)))
   {
-    _ctx.ms = wait_std;
+    ++begin;
   }
 
-  return _ctx.ms;
+  while (end > begin && OB::Text::is_punct(OB::Text::to_int32(word.at(end - 1).str)))
+  {
+    --end;
+  }
+
+  return OB::Text::foldcase(word.substr(begin, end - begin));
 }
 
 void Fltrdr::set_wpm_avg(int const i)
@@ -564,11 +997,28 @@ int Fltrdr::get_wpm_avg()
   return _ctx.wpm_avg;
 }
 
-void Fltrdr::calc_wpm_avg()
+void Fltrdr::calc_wpm_avg(std::chrono::microseconds const actual)
+{
+  // calc average wpm from the measured display time of the previous word,
+  // along with the rate the schedule alone would have given
+  _ctx.wpm_sched += static_cast<double>(_ctx.wait.count());
+  _ctx.wpm_actual += static_cast<double>(actual.count());
+  _ctx.wpm_count += static_cast<int>(_ctx.wait_words);
+
+  if (_ctx.wpm_actual > 0)
+  {
+    _ctx.wpm_avg = static_cast<int>(std::round(_ctx.wpm_count * 60000000.0 / _ctx.wpm_actual));
+  }
+
+  if (_ctx.wpm_sched > 0)
+  {
+    _ctx.wpm_target = static_cast<int>(std::round(_ctx.wpm_count * 60000000.0 / _ctx.wpm_sched));
+  }
+}
+
+int Fltrdr::get_wpm_target()
 {
-  // calc average wpm
-  _ctx.wpm_total += (60000 / _ctx.ms);
-  _ctx.wpm_avg = _ctx.wpm_total / ++_ctx.wpm_count;
+  return _ctx.wpm_target;
 }
 
 int Fltrdr::get_wpm()
@@ -610,6 +1060,59 @@ void Fltrdr::dec_wpm()
   }
 }
 
+bool Fltrdr::set_wpm_min(int const i)
+{
+  if (i < 1 || i > _ctx.wpm_max)
+  {
+    return false;
+  }
+
+  _ctx.wpm_min = i;
+  set_wpm(_ctx.wpm);
+
+  return true;
+}
+
+int Fltrdr::get_wpm_min()
+{
+  return _ctx.wpm_min;
+}
+
+bool Fltrdr::set_wpm_max(int const i)
+{
+  if (i < _ctx.wpm_min)
+  {
+    return false;
+  }
+
+  _ctx.wpm_max = i;
+  set_wpm(_ctx.wpm);
+
+  return true;
+}
+
+int Fltrdr::get_wpm_max()
+{
+  return _ctx.wpm_max;
+}
+
+bool Fltrdr::set_wpm_step(int const i)
+{
+  if (i < 1)
+  {
+    return false;
+  }
+
+  _ctx.wpm_diff = i;
+
+  return true;
+}
+
+int Fltrdr::get_wpm_step()
+{
+  return _ctx.wpm_diff;
+}
+
 std::string Fltrdr::get_stats()
 {
   std::ostringstream buf;
@@ -660,6 +1163,42 @@ int Fltrdr::get_show_next()
   return _ctx.show_next;
 }
 
+void Fltrdr::set_chunk(int const val)
+{
+  if (val >= _ctx.chunk_min && val <= _ctx.chunk_max)
+  {
+    _ctx.chunk = val;
+
+    if (! _ctx.words.empty())
+    {
+      set_chunk_size();
+    }
+  }
+}
+
+int Fltrdr::get_chunk()
+{
+  return _ctx.chunk;
+}
+
+void Fltrdr::set_chunk_cols(int const val)
+{
+  if (val >= 0 && val <= _ctx.chunk_cols_max)
+  {
+    _ctx.chunk_cols = val;
+
+    if (! _ctx.words.empty())
+    {
+      set_chunk_size();
+    }
+  }
+}
+
+int Fltrdr::get_chunk_cols()
+{
+  return _ctx.chunk_cols;
+}
+
 std::size_t Fltrdr::progress()
 {
   return static_cast<std::size_t>(_ctx.index / static_cast<double>(_ctx.index_max) * 100);
@@ -767,6 +1306,113 @@ bool Fltrdr::search(std::string const& rx, bool forward)
   }
 }
 
+// pattern without regex syntax, matching only its own text
+static bool is_plain(std::string const& rx)
+{
+  return rx.find_first_of("\\^$.|?*+()[]{}") == std::string::npos;
+}
+
+void Fltrdr::search_begin(bool const forward)
+{
+  auto& preview = _ctx.search.preview;
+
+  preview.forward = forward;
+  preview.index = _ctx.index;
+  preview.rx.clear();
+
+  // like search, matches after the start of the next word, or before the current one
+  if (forward)
+  {
+    preview.begin = _ctx.index < _ctx.words.size() ? _ctx.text.at(_ctx.words.at(_ctx.index)).bytes + 1 : _ctx.text.str().size();
+    preview.end = _ctx.text.str().size();
+  }
+  else
+  {
+    preview.begin = 0;
+    preview.end = get_offset();
+  }
+}
+
+OB::Text::Regex::Find Fltrdr::search_preview(std::string const& rx, std::function<bool()> const& stop)
+{
+  using Find = OB::Text::Regex::Find;
+
+  auto& preview = _ctx.search.preview;
+  auto begin = preview.begin;
+  auto end = preview.end;
+
+  if (rx.empty())
+  {
+    preview.rx.clear();
+    set_index(preview.index);
+
+    return Find::none;
+  }
+
+  // reuse the last scan when the pattern was only typed further
+  if (! preview.rx.empty() && is_plain(rx) && is_plain(preview.rx) &&
+    rx.compare(0, preview.rx.size(), preview.rx) == 0)
+  {
+    if (preview.from == std::string::npos)
+    {
+      set_index(preview.index);
+
+      return Find::none;
+    }
+
+    if (preview.forward)
+    {
+      begin = preview.from;
+    }
+    else
+    {
+      end = preview.from + 1;
+    }
+  }
+
+  std::size_t pos {0};
+  Find res {Find::none};
+
+  try
+  {
+    res = OB::Text::Regex::find(rx, _ctx.text.str(), begin, end, ! preview.forward, stop, pos);
+  }
+  catch (...)
+  {
+    // a pattern being typed is often not valid yet
+    res = Find::none;
+  }
+
+  if (res == Find::stopped)
+  {
+    preview.rx.clear();
+
+    return res;
+  }
+
+  preview.rx = rx;
+  preview.from = res == Find::found ? pos : std::string::npos;
+
+  if (res == Find::found)
+  {
+    // word containing the start of the match
+    auto const chr = _ctx.text.byte_to_char(pos);
+    auto const index = static_cast<std::size_t>(std::upper_bound(_ctx.words.begin(), _ctx.words.end(), chr) - _ctx.words.begin());
+    set_index(index);
+  }
+  else
+  {
+    set_index(preview.index);
+  }
+
+  return res;
+}
+
+void Fltrdr::search_cancel()
+{
+  set_index(_ctx.search.preview.index);
+}
+
 void Fltrdr::reset_timer()
 {
   timer.reset();
@@ -775,6 +1421,8 @@ void Fltrdr::reset_timer()
 void Fltrdr::reset_wpm_avg()
 {
   _ctx.wpm_avg = 0;
+  _ctx.wpm_target = 0;
   _ctx.wpm_count = 0;
-  _ctx.wpm_total = 0;
+  _ctx.wpm_sched = 0;
+  _ctx.wpm_actual = 0;
 }
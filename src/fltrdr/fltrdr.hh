@@ -7,11 +7,16 @@
 namespace aec = OB::Term::ANSI_Escape_Codes;
 
 #include <cstddef>
+#include <cstdint>
 
 #include <string>
 #include <vector>
 #include <sstream>
 #include <iostream>
+#include <chrono>
+#include <functional>
+#include <unordered_map>
+#include <utility>
 
 class Fltrdr
 {
@@ -25,12 +30,28 @@ public:
     std::string next {};
   };
 
+  // display time of a word as a multiple of the time per word at the set wpm
+  using Timing = std::function<double(Fltrdr& fltrdr, OB::Text::View const& word)>;
+
+  // word offset from a position and the hash of the words starting there
+  using Anchors = std::vector<std::pair<std::int64_t, std::uint64_t>>;
+
   Fltrdr() = default;
 
   void init();
   bool parse(std::istream& input);
   std::string content_id();
 
+  // sorted sample of the hashes of content defined chunks of the text,
+  // two samples estimate how much of their texts is shared
+  std::vector<std::uint64_t> const& fingerprints();
+  static double similarity(std::vector<std::uint64_t> const& lhs, std::vector<std::uint64_t> const& rhs);
+
+  // hashes of the words around the current word,
+  // and moving to the position they best match in this text
+  Anchors anchors();
+  bool relocate(Anchors const& anchors, std::size_t const index);
+
   Fltrdr& screen_size(std::size_t const width, std::size_t const height);
 
   bool eof();
@@ -41,25 +62,38 @@ public:
   OB::Text::View buf_prev(std::size_t offset = 0);
   OB::Text::View buf_next(std::size_t offset = 0);
 
-  void set_focus_point();
+  void set_focus_point(OB::Text::View& unit);
 
   void set_line(std::size_t offset = 0);
   Line get_line();
 
-  int get_wait();
+  std::chrono::microseconds get_wait();
+
+  void set_timing(Timing const& timing, std::string const& name);
+  bool set_timing(std::string const& name);
+  std::string get_timing();
 
   void set_index(std::size_t i);
   std::size_t get_index();
+  std::size_t get_offset();
 
   int get_wpm();
   void set_wpm(int const i);
   void inc_wpm();
   void dec_wpm();
 
+  bool set_wpm_min(int const i);
+  int get_wpm_min();
+  bool set_wpm_max(int const i);
+  int get_wpm_max();
+  bool set_wpm_step(int const i);
+  int get_wpm_step();
+
   void set_wpm_avg(int const i);
   int get_wpm_avg();
 
-  void calc_wpm_avg();
+  void calc_wpm_avg(std::chrono::microseconds const actual);
+  int get_wpm_target();
   std::string get_stats();
 
   void set_show_line(bool const val);
@@ -71,12 +105,19 @@ public:
   void set_show_next(int const val);
   int get_show_next();
 
+  void set_chunk(int const val);
+  int get_chunk();
+
+  void set_chunk_cols(int const val);
+  int get_chunk_cols();
+
   std::size_t progress();
 
   OB::Text::View word();
   void current_word();
   bool prev_word();
   bool next_word();
+  bool next_chunk();
 
   void prev_sentence();
   void next_sentence();
@@ -88,6 +129,13 @@ public:
   bool search_prev();
   bool search(std::string const& rx, bool forward);
 
+  // incremental search from the current word,
+  // a preview moves to the match of a pattern still being typed,
+  // 'stop' is polled during the scan and ends it early by returning true
+  void search_begin(bool const forward);
+  OB::Text::Regex::Find search_preview(std::string const& rx, std::function<bool()> const& stop);
+  void search_cancel();
+
   void reset_timer();
   void reset_wpm_avg();
 
@@ -114,9 +162,17 @@ private:
     // text buffer
     OB::Text::String text;
 
+    // text position of the leading space of each word, indexed by word index - 1
+    // gives constant time word movement and context windows
+    std::vector<std::size_t> words;
+
     // sha256 hash of the text buffer
     std::string content_id;
 
+    // hash of each word and fingerprints of the text, built on first use
+    std::vector<std::uint64_t> hashes;
+    std::vector<std::uint64_t> prints;
+
     // current rendered line
     Line line;
 
@@ -135,20 +191,46 @@ private:
     // current word
     OB::Text::View word;
 
+    // words shown per flash, starting at the current word
+    // limited to 'chunk' words, or to 'chunk_cols' display columns when set,
+    // and always to what fits in half the screen
+    int chunk {1};
+    int chunk_min {1};
+    int chunk_max {20};
+    int chunk_cols {0};
+    int chunk_cols_max {200};
+    std::size_t chunk_size {1};
+
+    // current chunk, only built when it holds more than one word
+    OB::Text::View chunk_view;
+
     OB::Text::View prev;
     OB::Text::View next;
 
     // words per minute
-    int const wpm_diff {10};
-    int const wpm_min {60};
-    int const wpm_max {1200};
+    int wpm_diff {10};
+    int wpm_min {60};
+    int wpm_max {1200};
     int wpm {250};
     int wpm_avg {0};
+    int wpm_target {0};
     int wpm_count {0};
-    int wpm_total {0};
 
-    // wait time in milliseconds
-    int ms {0};
+    // accumulated scheduled and measured display time in microseconds
+    double wpm_sched {0};
+    double wpm_actual {0};
+
+    // display time of the current word or chunk and the words it covered
+    std::chrono::microseconds wait {0};
+    std::size_t wait_words {1};
+
+    // word display time model
+    Timing timing {&Fltrdr::timing_default};
+    std::string timing_name {"default"};
+
+    // occurrences of each word in the text, built on first use
+    std::unordered_map<std::string, std::size_t> freq;
+    std::size_t freq_max {0};
 
     // toggle prev and next buffer surrounding current word in line
     bool show_line {false};
@@ -162,12 +244,41 @@ private:
       OB::Text::Regex it;
       std::string rx;
       bool forward {true};
+
+      struct Preview
+      {
+        bool forward {true};
+
+        // word index it started from, and the bytes a match may start in
+        std::size_t index {1};
+        std::size_t begin {0};
+        std::size_t end {0};
+
+        // last pattern scanned to the end and the byte its match starts at,
+        // npos when it has none, a plain pattern extending it can't match before it
+        std::string rx;
+        std::size_t from {0};
+      } preview;
     } search;
 
     // sentence end characters
     OB::Text::String sentence_end {".!?"};
   } _ctx;
 
+  void index_words();
+  void index_hashes();
+  std::uint64_t window(std::size_t const begin);
+  void set_chunk_size();
+  OB::Text::View& shown();
+
+  static double timing_flat(Fltrdr& fltrdr, OB::Text::View const& word);
+  static double timing_length(Fltrdr& fltrdr, OB::Text::View const& word);
+  static double timing_punct(Fltrdr& fltrdr, OB::Text::View const& word);
+  static double timing_freq(Fltrdr& fltrdr, OB::Text::View const& word);
+  static double timing_default(Fltrdr& fltrdr, OB::Text::View const& word);
+
+  static std::string word_key(OB::Text::View const& word);
+
   bool search_forward();
   bool search_backward();
 };
@@ -0,0 +1,272 @@
+#include "fltrdr/state.hh"
+
+#include "ob/timer.hh"
+
+#include <cstddef>
+#include <cstdint>
+
+#include <string>
+#include <string_view>
+#include <sstream>
+#include <fstream>
+#include <iterator>
+#include <algorithm>
+#include <optional>
+#include <chrono>
+
+#include <filesystem>
+namespace fs = std::filesystem;
+
+// record layout, version 2
+//   magic 'FLTS', u32 version,
+//   u64 index, u64 offset, u32 wpm, u32 wpm_avg, i64 timer ns,
+//   u32 chunk, u32 chunk_cols, i64 saved,
+//   u32 size + timing, u32 size + file,
+//   u32 count + u64 prints, u32 count + (i64 delta, u64 hash) anchors
+// version 1 records end after file
+static std::string_view constexpr magic {"FLTS"};
+
+template<typename T>
+static void put(std::string& buf, T const val)
+{
+  auto const uval = static_cast<std::uint64_t>(val);
+
+  for (std::size_t i = 0; i < sizeof(T); ++i)
+  {
+    buf += static_cast<char>((uval >> (i * 8)) & 0xff);
+  }
+}
+
+template<typename T>
+static bool get(std::string_view const buf, std::size_t& pos, T& val)
+{
+  if (buf.size() - pos < sizeof(T))
+  {
+    return false;
+  }
+
+  std::uint64_t uval {0};
+
+  for (std::size_t i = 0; i < sizeof(T); ++i)
+  {
+    uval |= static_cast<std::uint64_t>(static_cast<unsigned char>(buf[pos + i])) << (i * 8);
+  }
+
+  val = static_cast<T>(uval);
+  pos += sizeof(T);
+
+  return true;
+}
+
+static void put_str(std::string& buf, std::string const& str)
+{
+  put(buf, static_cast<std::uint32_t>(str.size()));
+  buf += str;
+}
+
+static bool get_str(std::string_view const buf, std::size_t& pos, std::string& str)
+{
+  std::uint32_t size {0};
+
+  if (! get(buf, pos, size) || buf.size() - pos < size)
+  {
+    return false;
+  }
+
+  str = buf.substr(pos, size);
+  pos += size;
+
+  return true;
+}
+
+std::string State::str() const
+{
+  std::string buf {magic};
+
+  put(buf, version);
+  put(buf, index);
+  put(buf, offset);
+  put(buf, wpm);
+  put(buf, wpm_avg);
+  put(buf, static_cast<std::int64_t>(timer.count()));
+  put(buf, chunk);
+  put(buf, chunk_cols);
+  put(buf, saved);
+  put_str(buf, timing);
+  put_str(buf, file);
+
+  put(buf, static_cast<std::uint32_t>(prints.size()));
+
+  for (auto const val : prints)
+  {
+    put(buf, val);
+  }
+
+  put(buf, static_cast<std::uint32_t>(anchors.size()));
+
+  for (auto const& [delta, hash] : anchors)
+  {
+    put(buf, delta);
+    put(buf, hash);
+  }
+
+  return buf;
+}
+
+bool State::str(std::string_view const buf)
+{
+  if (buf.substr(0, magic.size()) != magic)
+  {
+    return false;
+  }
+
+  std::size_t pos {magic.size()};
+  std::uint32_t ver {0};
+
+  if (! get(buf, pos, ver) || ver < 1 || ver > version)
+  {
+    return false;
+  }
+
+  // decode into a copy so a damaged record leaves the state untouched
+  State res;
+  std::int64_t ns {0};
+
+  if (! (get(buf, pos, res.index) && get(buf, pos, res.offset) &&
+    get(buf, pos, res.wpm) && get(buf, pos, res.wpm_avg) && get(buf, pos, ns) &&
+    get(buf, pos, res.chunk) && get(buf, pos, res.chunk_cols) && get(buf, pos, res.saved) &&
+    get_str(buf, pos, res.timing) && get_str(buf, pos, res.file)))
+  {
+    return false;
+  }
+
+  if (ver >= 2)
+  {
+    std::uint32_t count {0};
+
+    if (! get(buf, pos, count) || (buf.size() - pos) / 8 < count)
+    {
+      return false;
+    }
+
+    res.prints.resize(count);
+
+    for (auto& val : res.prints)
+    {
+      get(buf, pos, val);
+    }
+
+    if (! get(buf, pos, count) || (buf.size() - pos) / 16 < count)
+    {
+      return false;
+    }
+
+    res.anchors.resize(count);
+
+    for (auto& [delta, hash] : res.anchors)
+    {
+      get(buf, pos, delta);
+      get(buf, pos, hash);
+    }
+  }
+
+  res.timer = std::chrono::nanoseconds(ns);
+  *this = std::move(res);
+
+  return true;
+}
+
+std::string State::text() const
+{
+  OB::Timer time;
+  time.time(timer);
+
+  std::ostringstream buf;
+
+  buf
+  << "goto " << index << "\n"
+  << "wpm " << wpm << "\n"
+  << "wpm-avg " << wpm_avg << "\n"
+  << "timer " << time.str() << "\n"
+  << "chunk " << chunk << "\n"
+  << "chunk-cols " << chunk_cols << "\n"
+  << "timing " << timing << "\n";
+
+  return buf.str();
+}
+
+void State::text(std::string_view const str)
+{
+  std::size_t begin {0};
+
+  while (begin < str.size())
+  {
+    auto end = str.find('\n', begin);
+
+    if (end == std::string_view::npos)
+    {
+      end = str.size();
+    }
+
+    auto const line = str.substr(begin, end - begin);
+    begin = end + 1;
+
+    auto const space = line.find(' ');
+
+    if (line.empty() || line.front() == '#' || space == std::string_view::npos)
+    {
+      continue;
+    }
+
+    auto const key = line.substr(0, space);
+    std::string const val {line.substr(space + 1)};
+
+    auto const num = [&]() -> std::optional<std::uint64_t> {
+      if (val.empty() || val.size() > 18 ||
+        ! std::all_of(val.begin(), val.end(), [](auto const ch) { return ch >= '0' && ch <= '9'; }))
+      {
+        return {};
+      }
+
+      return std::stoull(val);
+    };
+
+    if (key == "timing")
+    {
+      timing = val;
+    }
+    else if (key == "timer")
+    {
+      OB::Timer time;
+      time.str(val);
+      timer = time.time<std::chrono::nanoseconds>();
+    }
+    else if (auto const n = num())
+    {
+      if (key == "goto") index = n.value();
+      else if (key == "wpm") wpm = static_cast<std::uint32_t>(n.value());
+      else if (key == "wpm-avg") wpm_avg = static_cast<std::uint32_t>(n.value());
+      else if (key == "chunk") chunk = static_cast<std::uint32_t>(n.value());
+      else if (key == "chunk-cols") chunk_cols = static_cast<std::uint32_t>(n.value());
+    }
+  }
+}
+
+bool State::load(fs::path const& path)
+{
+  std::ifstream ifile {path, std::ios::binary};
+
+  if (! ifile.is_open())
+  {
+    return false;
+  }
+
+  std::string const buf {std::istreambuf_iterator<char>(ifile), std::istreambuf_iterator<char>()};
+
+  if (! str(buf))
+  {
+    text(buf);
+  }
+
+  return true;
+}
@@ -0,0 +1,72 @@
+#ifndef FLTRDR_STATE_HH
+#define FLTRDR_STATE_HH
+
+#include <cstddef>
+#include <cstdint>
+
+#include <string>
+#include <string_view>
+#include <vector>
+#include <utility>
+#include <chrono>
+
+#include <filesystem>
+namespace fs = std::filesystem;
+
+// saved reading position and settings of a document
+// stored as a versioned fixed layout record, integers are little endian
+class State
+{
+public:
+
+  static std::uint32_t constexpr version {2};
+
+  State() = default;
+
+  // encode as a binary record
+  std::string str() const;
+
+  // decode a binary record, false if it is not one or is damaged
+  bool str(std::string_view const buf);
+
+  // commands that restore the state when run, for export and import
+  std::string text() const;
+
+  // read the commands written by text, unknown lines are skipped
+  void text(std::string_view const str);
+
+  // read a binary record or a list of commands from a file
+  // false if the file could not be read
+  bool load(fs::path const& path);
+
+  // word index and byte offset of its leading space in the text
+  std::uint64_t index {1};
+  std::uint64_t offset {0};
+
+  std::uint32_t wpm {0};
+  std::uint32_t wpm_avg {0};
+
+  // total reading time
+  std::chrono::nanoseconds timer {0};
+
+  // words and display columns shown per flash
+  std::uint32_t chunk {1};
+  std::uint32_t chunk_cols {0};
+
+  // word display time model
+  std::string timing {"default"};
+
+  // seconds since the epoch when saved
+  std::int64_t saved {0};
+
+  // path the document was read from
+  std::string file;
+
+  // fingerprints of the text, to find this state again once the text has changed
+  std::vector<std::uint64_t> prints;
+
+  // word offsets and hashes of the words around the position, to find it again
+  std::vector<std::pair<std::int64_t, std::uint64_t>> anchors;
+}; // class State
+
+#endif // FLTRDR_STATE_HH
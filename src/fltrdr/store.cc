@@ -0,0 +1,642 @@
+#include "fltrdr/store.hh"
+
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/file.h>
+#include <sys/stat.h>
+
+#include <cerrno>
+#include <cstddef>
+#include <cstdint>
+
+#include <string>
+#include <string_view>
+#include <vector>
+#include <optional>
+#include <algorithm>
+#include <functional>
+#include <mutex>
+#include <chrono>
+
+#include <filesystem>
+namespace fs = std::filesystem;
+
+// log layout, version 1
+//   magic 'FLTL', u32 version,
+//   then entries of u32 checksum, u32 key size, u32 value size, i64 time, key, value
+// the checksum is fnv-1a over the rest of the entry, integers are little endian
+static std::string_view constexpr magic {"FLTL"};
+static std::uint32_t constexpr version {1};
+static std::size_t constexpr header_size {8};
+static std::size_t constexpr entry_size {20};
+
+// compact once the log is past this size and less than half of it is live
+static std::size_t constexpr compact_size {64 * 1024};
+
+template<typename T>
+static void put_int(std::string& buf, T const val)
+{
+  auto const uval = static_cast<std::uint64_t>(val);
+
+  for (std::size_t i = 0; i < sizeof(T); ++i)
+  {
+    buf += static_cast<char>((uval >> (i * 8)) & 0xff);
+  }
+}
+
+template<typename T>
+static T get_int(std::string_view const buf, std::size_t const pos)
+{
+  std::uint64_t uval {0};
+
+  for (std::size_t i = 0; i < sizeof(T); ++i)
+  {
+    uval |= static_cast<std::uint64_t>(static_cast<unsigned char>(buf[pos + i])) << (i * 8);
+  }
+
+  return static_cast<T>(uval);
+}
+
+static std::uint32_t checksum(std::string_view const buf)
+{
+  std::uint32_t res {0x811c9dc5};
+
+  for (auto const ch : buf)
+  {
+    res ^= static_cast<unsigned char>(ch);
+    res *= 0x01000193;
+  }
+
+  return res;
+}
+
+static bool write_all(int const fd, std::string_view const buf, std::size_t pos)
+{
+  std::size_t done {0};
+
+  while (done < buf.size())
+  {
+    auto const n = ::pwrite(fd, buf.data() + done, buf.size() - done, static_cast<off_t>(pos + done));
+
+    if (n == -1)
+    {
+      if (errno == EINTR)
+      {
+        continue;
+      }
+
+      return false;
+    }
+
+    done += static_cast<std::size_t>(n);
+  }
+
+  return true;
+}
+
+static bool read_all(int const fd, std::string& buf, std::size_t const pos)
+{
+  std::size_t done {0};
+
+  while (done < buf.size())
+  {
+    auto const n = ::pread(fd, buf.data() + done, buf.size() - done, static_cast<off_t>(pos + done));
+
+    if (n == -1 && errno == EINTR)
+    {
+      continue;
+    }
+
+    if (n <= 0)
+    {
+      return false;
+    }
+
+    done += static_cast<std::size_t>(n);
+  }
+
+  return true;
+}
+
+// exclusive lock on a file shared with other processes
+class Lock
+{
+public:
+
+  explicit Lock(int const fd) :
+    _fd {fd}
+  {
+    while (::flock(_fd, LOCK_EX) == -1 && errno == EINTR)
+    {
+    }
+  }
+
+  ~Lock()
+  {
+    ::flock(_fd, LOCK_UN);
+  }
+
+  Lock(Lock const&) = delete;
+  Lock& operator=(Lock const&) = delete;
+
+private:
+
+  int _fd;
+}; // class Lock
+
+Store::~Store()
+{
+  if (_fd != -1)
+  {
+    ::close(_fd);
+  }
+
+  if (_lock != -1)
+  {
+    ::close(_lock);
+  }
+}
+
+bool Store::open(fs::path const& path)
+{
+  std::lock_guard<std::mutex> guard {_mutex};
+
+  _path = path;
+
+  if (_lock != -1)
+  {
+    ::close(_lock);
+  }
+
+  // the log itself is replaced on compaction, so lock a file that stays put
+  auto const lock_path = _path.string() + ".lock";
+  _lock = ::open(lock_path.c_str(), O_RDWR | O_CREAT | O_CLOEXEC, 0644);
+
+  if (_lock == -1)
+  {
+    return false;
+  }
+
+  Lock lock {_lock};
+
+  return reopen();
+}
+
+bool Store::is_open()
+{
+  std::lock_guard<std::mutex> guard {_mutex};
+
+  return _fd != -1;
+}
+
+bool Store::reopen()
+{
+  if (_fd != -1)
+  {
+    ::close(_fd);
+  }
+
+  _index.clear();
+  _live = 0;
+  _end = header_size;
+  _ino = 0;
+
+  _fd = ::open(_path.c_str(), O_RDWR | O_CREAT | O_CLOEXEC, 0644);
+
+  if (_fd == -1)
+  {
+    return false;
+  }
+
+  struct stat st;
+
+  if (::fstat(_fd, &st) == -1)
+  {
+    ::close(_fd);
+    _fd = -1;
+
+    return false;
+  }
+
+  _ino = static_cast<std::uint64_t>(st.st_ino);
+
+  // a header cut short by a crash is written again
+  if (static_cast<std::size_t>(st.st_size) < header_size)
+  {
+    std::string buf {magic};
+    put_int(buf, version);
+
+    if (! write_all(_fd, buf, 0) || ::fdatasync(_fd) == -1)
+    {
+      ::close(_fd);
+      _fd = -1;
+
+      return false;
+    }
+  }
+  else
+  {
+    std::string buf(header_size, '\0');
+
+    if (! read_all(_fd, buf, 0) ||
+      std::string_view(buf).substr(0, magic.size()) != magic ||
+      get_int<std::uint32_t>(buf, magic.size()) != version)
+    {
+      // not a log this version can read, leave it alone
+      ::close(_fd);
+      _fd = -1;
+
+      return false;
+    }
+  }
+
+  return read(header_size);
+}
+
+bool Store::read(std::size_t const pos)
+{
+  struct stat st;
+
+  if (::fstat(_fd, &st) == -1)
+  {
+    return false;
+  }
+
+  auto const size = static_cast<std::size_t>(st.st_size);
+
+  if (size <= pos)
+  {
+    return true;
+  }
+
+  std::string buf(size - pos, '\0');
+
+  if (! read_all(_fd, buf, pos))
+  {
+    return false;
+  }
+
+  std::string_view const view {buf};
+  std::size_t i {0};
+
+  while (view.size() - i >= entry_size)
+  {
+    auto const ksize = get_int<std::uint32_t>(view, i + 4);
+    auto const vsize = get_int<std::uint32_t>(view, i + 8);
+    std::size_t const bytes {entry_size + ksize + vsize};
+
+    if (view.size() - i < bytes ||
+      get_int<std::uint32_t>(view, i) != checksum(view.substr(i + 4, bytes - 4)))
+    {
+      break;
+    }
+
+    std::string key {view.substr(i + entry_size, ksize)};
+
+    if (auto const it = _index.find(key); it != _index.end())
+    {
+      _live -= it->second.bytes;
+    }
+
+    auto& val = _index[std::move(key)];
+    val.pos = pos + i + entry_size + ksize;
+    val.size = vsize;
+    val.time = get_int<std::int64_t>(view, i + 12);
+    val.bytes = bytes;
+
+    _live += bytes;
+    i += bytes;
+  }
+
+  _end = pos + i;
+
+  // cut off an entry left half written by a crash
+  if (_end < size)
+  {
+    if (::ftruncate(_fd, static_cast<off_t>(_end)) == -1)
+    {
+      return false;
+    }
+  }
+
+  return true;
+}
+
+void Store::sync()
+{
+  // pick up what other processes wrote since the last look
+  struct stat st;
+
+  if (::stat(_path.c_str(), &st) == -1 || _fd == -1 ||
+    static_cast<std::uint64_t>(st.st_ino) != _ino ||
+    static_cast<std::size_t>(st.st_size) < _end)
+  {
+    reopen();
+  }
+  else if (static_cast<std::size_t>(st.st_size) > _end)
+  {
+    read(_end);
+  }
+}
+
+std::optional<std::string> Store::get(std::string const& key)
+{
+  std::lock_guard<std::mutex> guard {_mutex};
+
+  if (_lock == -1)
+  {
+    return {};
+  }
+
+  Lock lock {_lock};
+  sync();
+
+  auto const it = _index.find(key);
+
+  if (_fd == -1 || it == _index.end())
+  {
+    return {};
+  }
+
+  std::string res(it->second.size, '\0');
+
+  if (! read_all(_fd, res, it->second.pos))
+  {
+    return {};
+  }
+
+  return res;
+}
+
+bool Store::contains(std::string const& key)
+{
+  std::lock_guard<std::mutex> guard {_mutex};
+
+  if (_lock == -1)
+  {
+    return false;
+  }
+
+  Lock lock {_lock};
+  sync();
+
+  return _index.find(key) != _index.end();
+}
+
+bool Store::put(std::string const& key, std::string_view const val, std::int64_t const time)
+{
+  std::lock_guard<std::mutex> guard {_mutex};
+
+  if (_lock == -1)
+  {
+    return false;
+  }
+
+  Lock lock {_lock};
+  sync();
+
+  if (_fd == -1)
+  {
+    return false;
+  }
+
+  std::string buf;
+  buf.reserve(entry_size + key.size() + val.size());
+
+  put_int(buf, std::uint32_t {0});
+  put_int(buf, static_cast<std::uint32_t>(key.size()));
+  put_int(buf, static_cast<std::uint32_t>(val.size()));
+  put_int(buf, time);
+  buf += key;
+  buf += val;
+
+  auto const sum = checksum(std::string_view(buf).substr(4));
+
+  for (std::size_t i = 0; i < 4; ++i)
+  {
+    buf[i] = static_cast<char>((sum >> (i * 8)) & 0xff);
+  }
+
+  if (! write_all(_fd, buf, _end) || ::fdatasync(_fd) == -1)
+  {
+    // drop whatever part of the entry made it to the file
+    ::ftruncate(_fd, static_cast<off_t>(_end));
+
+    return false;
+  }
+
+  if (auto const it = _index.find(key); it != _index.end())
+  {
+    _live -= it->second.bytes;
+  }
+
+  auto& value = _index[key];
+  value.pos = _end + entry_size + key.size();
+  value.size = val.size();
+  value.time = time;
+  value.bytes = buf.size();
+
+  _live += buf.size();
+  _end += buf.size();
+
+  if (_end > compact_size && _live * 2 < _end)
+  {
+    compact_locked();
+  }
+
+  return true;
+}
+
+std::vector<Store::Entry> Store::list()
+{
+  std::lock_guard<std::mutex> guard {_mutex};
+
+  std::vector<Entry> res;
+
+  if (_lock == -1)
+  {
+    return res;
+  }
+
+  Lock lock {_lock};
+  sync();
+
+  res.reserve(_index.size());
+
+  for (auto const& [key, val] : _index)
+  {
+    res.emplace_back(Entry {key, val.time});
+  }
+
+  std::sort(res.begin(), res.end(), [](auto const& lhs, auto const& rhs) {
+    return lhs.time > rhs.time;
+  });
+
+  return res;
+}
+
+std::size_t Store::gc(std::size_t const count, std::chrono::seconds const age, bool const force)
+{
+  std::lock_guard<std::mutex> guard {_mutex};
+
+  if (_lock == -1)
+  {
+    return 0;
+  }
+
+  Lock lock {_lock};
+  sync();
+
+  if (_fd == -1)
+  {
+    return 0;
+  }
+
+  std::vector<std::pair<std::int64_t, std::string>> entries;
+  entries.reserve(_index.size());
+
+  for (auto const& [key, val] : _index)
+  {
+    entries.emplace_back(val.time, key);
+  }
+
+  // most recent first
+  std::sort(entries.begin(), entries.end(), std::greater<>());
+
+  auto const now = std::chrono::duration_cast<std::chrono::seconds>(
+    std::chrono::system_clock::now().time_since_epoch()).count();
+
+  std::size_t removed {0};
+
+  for (std::size_t i = 0; i < entries.size(); ++i)
+  {
+    auto const& [time, key] = entries.at(i);
+
+    if ((count && i >= count) || (age.count() && time < now - age.count()))
+    {
+      auto const it = _index.find(key);
+      _live -= it->second.bytes;
+      _index.erase(it);
+      ++removed;
+    }
+  }
+
+  if (removed || force || (_end > compact_size && _live * 2 < _end))
+  {
+    compact_locked();
+  }
+
+  return removed;
+}
+
+bool Store::compact()
+{
+  std::lock_guard<std::mutex> guard {_mutex};
+
+  if (_lock == -1)
+  {
+    return false;
+  }
+
+  Lock lock {_lock};
+  sync();
+
+  return compact_locked();
+}
+
+bool Store::compact_locked()
+{
+  if (_fd == -1)
+  {
+    return false;
+  }
+
+  // copy the live entries in log order into a new log
+  std::vector<Value const*> values;
+  values.reserve(_index.size());
+
+  for (auto const& [key, val] : _index)
+  {
+    values.emplace_back(&val);
+  }
+
+  std::sort(values.begin(), values.end(), [](auto const lhs, auto const rhs) {
+    return lhs->pos < rhs->pos;
+  });
+
+  std::string buf {magic};
+  put_int(buf, version);
+
+  for (auto const val : values)
+  {
+    std::string entry(val->bytes, '\0');
+
+    if (! read_all(_fd, entry, val->pos + val->size - val->bytes))
+    {
+      return false;
+    }
+
+    buf += entry;
+  }
+
+  auto const tmp = _path.string() + ".tmp";
+  auto const fd = ::open(tmp.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+
+  if (fd == -1)
+  {
+    return false;
+  }
+
+  // the data has to be on disk before the rename makes it visible
+  bool const ok {write_all(fd, buf, 0) && ::fsync(fd) == 0};
+  ::close(fd);
+
+  if (! ok || ::rename(tmp.c_str(), _path.c_str()) != 0)
+  {
+    ::unlink(tmp.c_str());
+
+    return false;
+  }
+
+  // persist the rename itself
+  auto const dir = _path.has_parent_path() ? _path.parent_path() : fs::path(".");
+  auto const dfd = ::open(dir.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+
+  if (dfd != -1)
+  {
+    ::fsync(dfd);
+    ::close(dfd);
+  }
+
+  return reopen();
+}
+
+std::size_t Store::size()
+{
+  std::lock_guard<std::mutex> guard {_mutex};
+
+  if (_lock == -1)
+  {
+    return 0;
+  }
+
+  Lock lock {_lock};
+  sync();
+
+  return _end;
+}
+
+std::size_t Store::live()
+{
+  std::lock_guard<std::mutex> guard {_mutex};
+
+  if (_lock == -1)
+  {
+    return 0;
+  }
+
+  Lock lock {_lock};
+  sync();
+
+  return header_size + _live;
+}
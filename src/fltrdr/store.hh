@@ -0,0 +1,102 @@
+#ifndef FLTRDR_STORE_HH
+#define FLTRDR_STORE_HH
+
+#include <cstddef>
+#include <cstdint>
+
+#include <string>
+#include <string_view>
+#include <vector>
+#include <optional>
+#include <unordered_map>
+#include <mutex>
+#include <chrono>
+
+#include <filesystem>
+namespace fs = std::filesystem;
+
+// append-only key value store in a single file,
+// an in-memory hash index maps each key to its latest value in the log,
+// the log is rewritten with only the live values once most of it is garbage
+// safe to use from several threads, and from several processes sharing the file
+class Store
+{
+public:
+
+  struct Entry
+  {
+    std::string key;
+
+    // time given with the value, seconds since the epoch
+    std::int64_t time {0};
+  };
+
+  Store() = default;
+  ~Store();
+
+  Store(Store const&) = delete;
+  Store& operator=(Store const&) = delete;
+
+  // open or create the log, a damaged tail is cut off
+  bool open(fs::path const& path);
+  bool is_open();
+
+  std::optional<std::string> get(std::string const& key);
+  bool put(std::string const& key, std::string_view const val, std::int64_t const time);
+  bool contains(std::string const& key);
+
+  // entries with the most recent first
+  std::vector<Entry> list();
+
+  // keep the 'count' most recent entries that are younger than 'age',
+  // a zero value disables that limit, then compact the log
+  // if entries were removed, it is mostly garbage, or 'force' is set
+  // returns the number of entries removed
+  std::size_t gc(std::size_t const count, std::chrono::seconds const age, bool const force = false);
+
+  // rewrite the log with only the live entries
+  bool compact();
+
+  // log size and the part of it that is live
+  std::size_t size();
+  std::size_t live();
+
+private:
+
+  struct Value
+  {
+    // position and size of the value in the log
+    std::size_t pos {0};
+    std::size_t size {0};
+    std::int64_t time {0};
+
+    // size of the whole log entry
+    std::size_t bytes {0};
+  };
+
+  bool reopen();
+  bool read(std::size_t pos);
+  void sync();
+  bool compact_locked();
+
+  fs::path _path;
+  int _fd {-1};
+
+  // lock shared with other processes using the same log
+  int _lock {-1};
+
+  // inode of the open log, another process compacting replaces it
+  std::uint64_t _ino {0};
+
+  // end of the last valid entry
+  std::size_t _end {0};
+
+  // bytes of the log taken up by live entries
+  std::size_t _live {0};
+
+  std::unordered_map<std::string, Value> _index;
+
+  std::mutex _mutex;
+}; // class Store
+
+#endif // FLTRDR_STORE_HH
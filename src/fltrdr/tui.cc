@@ -6,6 +6,8 @@
 #include "ob/term.hh"
 namespace aec = OB::Term::ANSI_Escape_Codes;
 
+#include <sys/stat.h>
+
 #include <ctime>
 #include <cmath>
 #include <cctype>
@@ -31,9 +33,30 @@ namespace aec = OB::Term::ANSI_Escape_Codes;
 #include <filesystem>
 namespace fs = std::filesystem;
 
+using namespace std::string_literals;
+
 Tui::Tui() :
-  _colorterm {OB::Term::is_colorterm()}
+  _term_mode {std::in_place},
+  _winch {std::in_place}
+{
+  OB::Color::depth(OB::Term::color_depth());
+  commands_init();
+  complete_init();
+}
+
+Tui::Tui(OB::VTerm& vterm) :
+  _vterm {&vterm}
+{
+  OB::Color::depth(OB::Term::Depth::bit24);
+  commands_init();
+  complete_init();
+}
+
+Tui::~Tui()
 {
+  // an exception out of the event loop skips the shutdown in run
+  autosave_stop();
+  writer_stop();
 }
 
 Tui& Tui::init(fs::path const& path)
@@ -86,11 +109,17 @@ Tui& Tui::init(fs::path const& path)
 
 bool Tui::press_to_continue(std::string const& str, char32_t val)
 {
+  // nothing to wait on without a terminal
+  if (! _term_mode)
+  {
+    return true;
+  }
+
   std::cerr
   << "Press " << str << " to continue";
 
-  _term_mode.set_min(1);
-  _term_mode.set_raw();
+  _term_mode->set_min(1);
+  _term_mode->set_raw();
 
   bool res {false};
   char32_t key {0};
@@ -99,7 +128,7 @@ bool Tui::press_to_continue(std::string const& str, char32_t val)
     res = (val == 0 ? true : val == key);
   }
 
-  _term_mode.set_cooked();
+  _term_mode->set_cooked();
 
   std::cerr
   << aec::nl;
@@ -110,6 +139,54 @@ bool Tui::press_to_continue(std::string const& str, char32_t val)
 void Tui::base_config(fs::path const& path)
 {
   _ctx.base_config = path;
+
+  auto const dir = path / fs::path("state");
+
+  if (! _store.open(dir / fs::path("store")))
+  {
+    return;
+  }
+
+  // move state files from older versions, one per content id, into the store
+  std::error_code ec;
+
+  for (auto const& entry : fs::directory_iterator(dir, ec))
+  {
+    auto const name = entry.path().filename().string();
+
+    if (name.size() != 64 || ! entry.is_regular_file(ec) ||
+      ! std::all_of(name.begin(), name.end(), [](auto const ch) { return std::isxdigit(static_cast<unsigned char>(ch)); }))
+    {
+      continue;
+    }
+
+    State state;
+
+    if (! state.load(entry.path()))
+    {
+      continue;
+    }
+
+    if (! _store.contains(name))
+    {
+      if (! state.saved)
+      {
+        struct stat st;
+
+        if (::stat(entry.path().c_str(), &st) == 0)
+        {
+          state.saved = static_cast<std::int64_t>(st.st_mtime);
+        }
+      }
+
+      if (! _store.put(name, state.str(), state.saved))
+      {
+        continue;
+      }
+    }
+
+    fs::remove(entry.path(), ec);
+  }
 }
 
 void Tui::load_config(fs::path const& path)
@@ -141,7 +218,7 @@ void Tui::load_config(fs::path const& path)
         line = OB::String::trim(line);
 
         // ignore empty line or comment
-        if (line.empty() || OB::String::assert_rx(line, std::regex("^#[^\\r]*$")))
+        if (line.empty() || line.front() == '#')
         {
           continue;
         }
@@ -173,6 +250,38 @@ void Tui::load_config(fs::path const& path)
   }
 }
 
+State Tui::get_state()
+{
+  State state;
+
+  state.index = _fltrdr.get_index();
+  state.offset = _fltrdr.get_offset();
+  state.wpm = static_cast<std::uint32_t>(_fltrdr.get_wpm());
+  state.wpm_avg = static_cast<std::uint32_t>(_fltrdr.get_wpm_avg());
+  state.timer = _fltrdr.timer.time<std::chrono::nanoseconds>();
+  state.chunk = static_cast<std::uint32_t>(_fltrdr.get_chunk());
+  state.chunk_cols = static_cast<std::uint32_t>(_fltrdr.get_chunk_cols());
+  state.timing = _fltrdr.get_timing();
+  state.saved = std::chrono::duration_cast<std::chrono::seconds>(
+    std::chrono::system_clock::now().time_since_epoch()).count();
+  state.file = _ctx.file.path.string();
+  state.prints = _fltrdr.fingerprints();
+  state.anchors = _fltrdr.anchors();
+
+  return state;
+}
+
+void Tui::set_state(State const& state)
+{
+  _fltrdr.set_wpm(static_cast<int>(state.wpm));
+  _fltrdr.set_wpm_avg(static_cast<int>(state.wpm_avg));
+  _fltrdr.timer.time(state.timer);
+  _fltrdr.set_chunk(static_cast<int>(state.chunk));
+  _fltrdr.set_chunk_cols(static_cast<int>(state.chunk_cols));
+  _fltrdr.set_timing(state.timing);
+  _fltrdr.set_index(static_cast<std::size_t>(state.index));
+}
+
 bool Tui::save_state()
 {
   if (_ctx.base_config.empty())
@@ -191,34 +300,48 @@ bool Tui::save_state()
     return false;
   }
 
-  fs::path path {_ctx.base_config / fs::path("state") / fs::path(_fltrdr.content_id())};
-
-  std::ofstream file {path, std::ios::trunc};
-
-  if (! file.is_open())
+  if (! write_state(state_key(), get_state()))
   {
-    set_status(false, "could not open file");
+    set_status(false, "could not write state file");
 
     return false;
   }
 
-  // timestamp
-  std::time_t t = std::time(0);
-  std::tm tm = *std::localtime(&t);
+  set_status(true, "saved state");
 
-  // dump current state to file
-  file
-  << "# fltrdr state\n"
-  << "# file: " << _ctx.file.path.string() << "\n"
-  << "# date: " << std::put_time(&tm, "%FT%TZ\n")
-  << "\n"
-  << "goto " << _fltrdr.get_index() << "\n"
-  << "wpm " << _fltrdr.get_wpm() << "\n"
-  << "wpm-avg " << _fltrdr.get_wpm_avg() << "\n"
-  << "timer " << _fltrdr.timer.str() << "\n"
-  << std::flush;
+  return true;
+}
 
-  set_status(true, "saved state");
+std::string Tui::state_key()
+{
+  if (! _store.is_open())
+  {
+    return {};
+  }
+
+  return _fltrdr.content_id();
+}
+
+bool Tui::write_state(std::string const& key, State const& state)
+{
+  // the save time alone doesn't make a state worth writing again
+  auto bare = state;
+  bare.saved = 0;
+  auto const record = key + '\0' + bare.str();
+
+  std::lock_guard<std::mutex> lock {_autosave.io};
+
+  if (record == _autosave.last)
+  {
+    return true;
+  }
+
+  if (key.empty() || ! _store.put(key, state.str(), state.saved))
+  {
+    return false;
+  }
+
+  _autosave.last = record;
 
   return true;
 }
@@ -237,35 +360,126 @@ bool Tui::load_state()
     return false;
   }
 
-  fs::path path {_ctx.base_config / fs::path("state") / fs::path(_fltrdr.content_id())};
+  auto const val = _store.get(content_id);
 
-  if (! fs::exists(path))
+  if (! val)
+  {
+    // the text may have been edited since it was last read
+    return recover_state();
+  }
+
+  State state;
+
+  if (! state.str(val.value()))
   {
     return false;
   }
 
-  std::ifstream file {path};
+  set_state(state);
+
+  return true;
+}
 
-  if (file.is_open())
+bool Tui::recover_state()
+{
+  // the saved state of the most similar text, if similar enough
+  auto const& prints = _fltrdr.fingerprints();
+
+  State best;
+  double score {0.5};
+  bool found {false};
+
+  for (auto const& entry : _store.list())
   {
-    std::string line;
-    std::size_t lnum {0};
+    auto const val = _store.get(entry.key);
+    State state;
 
-    while (std::getline(file, line))
+    if (! val || ! state.str(val.value()) || state.prints.empty())
     {
-      // ignore empty line or comment
-      if (line.empty() || OB::String::assert_rx(line, std::regex("^#[^\\r]*$")))
-      {
-        continue;
-      }
+      continue;
+    }
 
-      command(line);
+    auto const similarity = Fltrdr::similarity(prints, state.prints);
+
+    if (similarity > score || (! found && similarity == score))
+    {
+      best = std::move(state);
+      score = similarity;
+      found = true;
+    }
+  }
+
+  if (! found)
+  {
+    return false;
+  }
+
+  set_state(best);
+
+  // keep the old index when none of the words around it are left
+  if (! _fltrdr.relocate(best.anchors, static_cast<std::size_t>(best.index)))
+  {
+    set_status(false, "recovered state without its position");
+
+    return true;
+  }
+
+  set_status(true, "recovered state from an earlier version of the text");
+
+  return true;
+}
+
+bool Tui::import_state(fs::path const& path)
+{
+  std::ifstream file {path};
+
+  if (! file.is_open())
+  {
+    return false;
+  }
+
+  std::string line;
+
+  while (std::getline(file, line))
+  {
+    // ignore empty line or comment
+    if (line.empty() || line.front() == '#')
+    {
+      continue;
     }
+
+    command(line);
   }
 
   return true;
 }
 
+bool Tui::export_state(fs::path const& path)
+{
+  std::ofstream file {path, std::ios::trunc};
+
+  if (! file.is_open())
+  {
+    return false;
+  }
+
+  auto const state = get_state();
+
+  // timestamp
+  std::time_t t = static_cast<std::time_t>(state.saved);
+  std::tm tm = *std::localtime(&t);
+
+  file
+  << "# fltrdr state\n"
+  << "# file: " << state.file << "\n"
+  << "# date: " << std::put_time(&tm, "%FT%TZ\n")
+  << "\n"
+  << state.text()
+  << std::flush;
+
+  return file.good();
+}
+
 void Tui::load_hist_command(fs::path const& path)
 {
   _readline.hist_load(path);
@@ -276,6 +490,19 @@ void Tui::load_hist_search(fs::path const& path)
   _readline_search.hist_load(path);
 }
 
+void Tui::perf_log(fs::path const& path)
+{
+  _ctx.perf.log.open(path, std::ios::trunc);
+
+  if (! _ctx.perf.log.is_open())
+  {
+    throw std::runtime_error("could not open the file '" + path.string() + "'");
+  }
+
+  _ctx.perf.log
+  << "# frame time_us set_line_us draw_us serialise_us write_us bytes scheduled_us actual_us dropped\n";
+}
+
 void Tui::run()
 {
   std::cout
@@ -288,12 +515,23 @@ void Tui::run()
   << std::flush;
 
   // set terminal mode to raw
-  _term_mode.set_min(0);
-  _term_mode.set_raw();
+  _term_mode->set_min(0);
+  _term_mode->set_raw();
+
+  writer_start();
+  autosave_start();
 
   // start the event loop
   event_loop();
 
+  autosave(true);
+  autosave_stop();
+  writer_stop();
+
+  _store.gc(_retain.count, _retain.age);
+  _readline.hist_compact();
+  _readline_search.hist_compact();
+
   std::cout
   << aec::mouse_disable
   << aec::nl
@@ -306,17 +544,21 @@ void Tui::event_loop()
 {
   while (_ctx.is_running)
   {
-    // get the terminal width and height
-    OB::Term::size(_ctx.width, _ctx.height);
+    if (OB::Term::Winch::changed() || _ctx.relayout)
+    {
+      layout();
+    }
+
+    autosave();
 
     // check for correct screen size
     if (screen_size() != 0)
     {
       pause();
-      std::this_thread::sleep_for(std::chrono::milliseconds(_ctx.input_interval));
 
+      // wait for a key or a resize
       char32_t key {0};
-      if ((key = OB::Term::get_key()) > 0)
+      if (OB::Term::wait_input() && (key = OB::Term::get_key()) > 0)
       {
         switch (key)
         {
@@ -334,24 +576,37 @@ void Tui::event_loop()
           }
         }
       }
+      else if (OB::Term::input_closed())
+      {
+        _ctx.is_running = false;
+      }
 
       continue;
     }
 
-    // update screen size
-    _fltrdr.screen_size(_ctx.width, _ctx.height);
-
-    // update offset
-    _ctx.offset = static_cast<std::size_t>(_ctx.offset_value / 10.0 * static_cast<double>(_ctx.width / 2));
-
     // play
     if (_ctx.state.play && ! _ctx.state.counting_down)
     {
-      // move to next word
-      _fltrdr.next_word();
+      // measure how long the previous word was actually shown
+      auto const now = Clock::now();
+      bool const measured {_ctx.perf.word != Clock::time_point()};
+
+      if (measured)
+      {
+        _ctx.perf.scheduled = _ctx.state.wait;
+        _ctx.perf.actual = now - _ctx.perf.word;
+      }
+
+      _ctx.perf.word = now;
+
+      // move to next word or chunk of words
+      _fltrdr.next_chunk();
 
       // calculate new wpm average
-      _fltrdr.calc_wpm_avg();
+      if (measured)
+      {
+        _fltrdr.calc_wpm_avg(std::chrono::duration_cast<std::chrono::microseconds>(_ctx.perf.actual));
+      }
 
       // check for end of file
       if (_fltrdr.eof())
@@ -360,11 +615,22 @@ void Tui::event_loop()
       }
     }
 
-    // render new content
-    _fltrdr.set_line(_ctx.offset);
-    clear();
-    draw();
-    refresh();
+    // display time of the new word, compared against the writer below
+    set_wait();
+
+    // keep words on schedule and skip the frame when the terminal can't keep up,
+    // it is drawn once the writer catches up if the word is still current
+    if (_ctx.state.play && ! _ctx.state.counting_down && writer_behind())
+    {
+      ++_ctx.perf.dropped;
+      _ctx.perf.skipped = true;
+    }
+    else
+    {
+      // render new content
+      _ctx.perf.skipped = false;
+      render();
+    }
 
     if (_ctx.state.counting_down)
     {
@@ -372,6 +638,7 @@ void Tui::event_loop()
       {
         _ctx.state.counting_down = false;
         _fltrdr.timer.start();
+        set_wait();
       }
       else
       {
@@ -379,59 +646,521 @@ void Tui::event_loop()
       }
     }
 
-    set_wait();
     auto wait = _ctx.state.wait;
 
-    while (_ctx.is_running && wait)
+    // chain the deadline from the previous one while playing,
+    // so render time and sleep overshoot don't accumulate,
+    // resync if more than a whole word behind
+    auto const now = Clock::now();
+    auto const duration = wait;
+
+    if (_ctx.state.play && _ctx.state.deadline != Clock::time_point() &&
+      now < _ctx.state.deadline + duration)
     {
-      if (wait > _ctx.input_interval)
+      _ctx.state.deadline += duration;
+    }
+    else
+    {
+      _ctx.state.deadline = now + duration;
+    }
+
+    // block on input until the next deadline,
+    // while paused only a prompt message expiring needs a redraw
+    while (_ctx.is_running && wait != wait.zero())
+    {
+      auto const time = Clock::now();
+      auto deadline = _ctx.state.deadline;
+
+      if (! _ctx.state.play)
+      {
+        deadline = _ctx.prompt.expire == Clock::time_point() ? Clock::time_point::max() : _ctx.prompt.expire;
+
+        // wake for the next checkpoint if the position changed since the last one
+        if (_autosave.thread.joinable() && _autosave.interval.count() &&
+          _fltrdr.get_index() != _autosave.index)
+        {
+          deadline = std::min(deadline, _autosave.next);
+        }
+      }
+
+      if (time >= deadline)
+      {
+        // a wake for the checkpoint keeps the message until it expires,
+        // the checkpoint itself runs at the top of the event loop
+        if (! _ctx.state.play && _ctx.prompt.expire != Clock::time_point() &&
+          time >= _ctx.prompt.expire)
+        {
+          _ctx.prompt.expire = {};
+        }
+
+        break;
+      }
+
+      // check on the writer while a skipped frame is waiting to be drawn
+      if (_ctx.perf.skipped)
       {
-        std::this_thread::sleep_for(std::chrono::milliseconds(_ctx.input_interval));
-        wait -= _ctx.input_interval;
+        auto const poll = Clock::duration(_writer.write_avg.load(std::memory_order_relaxed)) / 4;
+        deadline = std::min(deadline, time + std::max(poll, Clock::duration(std::chrono::milliseconds(1))));
       }
-      else
+
+      int timeout {-1};
+
+      if (deadline != Clock::time_point::max())
+      {
+        // round up so the deadline has passed on wake
+        timeout = static_cast<int>(std::chrono::ceil<std::chrono::milliseconds>(deadline - time).count());
+      }
+
+      if (OB::Term::wait_input(timeout))
+      {
+        get_input(wait);
+      }
+      else if (OB::Term::input_closed())
+      {
+        _ctx.is_running = false;
+
+        break;
+      }
+
+      // the terminal caught up while the skipped word is still shown
+      if (_ctx.perf.skipped && _writer.written.load() == _writer.pushed)
       {
-        std::this_thread::sleep_for(std::chrono::milliseconds(wait));
-        wait = 0;
+        _ctx.perf.skipped = false;
+        render();
       }
 
-      get_input(wait);
+      // redraw at the new size without touching the schedule
+      if (OB::Term::Winch::changed() || _ctx.relayout)
+      {
+        layout();
+
+        if (screen_size() != 0)
+        {
+          break;
+        }
+
+        render();
+      }
     }
   }
 }
 
-void Tui::clear()
+void Tui::layout()
 {
-  // clear screen
-  _ctx.buf
-  << aec::cursor_home
-  << _ctx.style.bg;
+  // get the terminal width and height
+  if (_vterm != nullptr)
+  {
+    _ctx.width = _vterm->width();
+    _ctx.height = _vterm->height();
+  }
+  else
+  {
+    OB::Term::size(_ctx.width, _ctx.height);
+  }
 
-  OB::Algorithm::for_each(_ctx.height,
-  [&](auto) {
-    OB::Algorithm::for_each(_ctx.width, [&](auto) {
-      _ctx.buf << " "; });
-    _ctx.buf << "\n";
-  },
-  [&](auto) {
-    OB::Algorithm::for_each(_ctx.width, [&](auto) {
-      _ctx.buf << " "; });
-  });
+  // update screen size
+  _fltrdr.screen_size(_ctx.width, _ctx.height);
 
-  _ctx.buf
-  << aec::clear
-  << aec::cursor_home;
+  // update offset
+  _ctx.offset = static_cast<std::size_t>(_ctx.offset_value / 10.0 * static_cast<double>(_ctx.width / 2));
+
+  _ctx.relayout = false;
 }
 
-void Tui::refresh()
+std::chrono::microseconds Tui::step()
 {
-  // output buffer to screen
-  std::cout
-  << _ctx.buf.str()
-  << std::flush;
+  if (_vterm == nullptr || _ctx.state.step_end)
+  {
+    return {};
+  }
+
+  if (_ctx.relayout)
+  {
+    layout();
+  }
+
+  if (screen_size() != 0)
+  {
+    return {};
+  }
+
+  if (! _ctx.state.play)
+  {
+    // load the word at the start position
+    _fltrdr.set_index(_fltrdr.get_index());
+  }
+
+  _ctx.state.play = true;
+  _ctx.status.mode = "PLAY";
+
+  auto const wait = _fltrdr.get_wait();
+  _fltrdr.calc_wpm_avg(wait);
+
+  render();
+
+  // show the current word before moving past it
+  if (_fltrdr.eof())
+  {
+    _ctx.state.step_end = true;
+  }
+  else
+  {
+    _fltrdr.next_chunk();
+  }
+
+  return wait;
+}
+
+void Tui::render()
+{
+  auto const begin = Clock::now();
+
+  _fltrdr.set_line(_ctx.offset);
+
+  auto const line = Clock::now();
+
+  clear();
+  draw();
+
+  _ctx.perf.set_line = line - begin;
+  _ctx.perf.draw = Clock::now() - line;
+
+  refresh();
+}
+
+void Tui::clear()
+{
+  // clear screen
+  _ctx.buf
+  << aec::cursor_home
+  << _ctx.style.bg;
+
+  OB::Algorithm::for_each(_ctx.height,
+  [&](auto) {
+    OB::Algorithm::for_each(_ctx.width, [&](auto) {
+      _ctx.buf << " "; });
+    _ctx.buf << "\n";
+  },
+  [&](auto) {
+    OB::Algorithm::for_each(_ctx.width, [&](auto) {
+      _ctx.buf << " "; });
+  });
+
+  _ctx.buf
+  << aec::clear
+  << aec::cursor_home;
+}
+
+void Tui::refresh()
+{
+  auto const begin = Clock::now();
+
+  // serialise into the writer's mailbox slot or the frame buffer,
+  // both are reused so a frame only allocates when it outgrows them
+  bool const writer {_vterm == nullptr && _writer.thread.joinable()};
+  auto& str = writer ? _writer.frames.back().str : _ctx.frame;
+
+  str.resize(static_cast<std::size_t>(_ctx.buf.tellp()));
+  _ctx.buf.read(str.data(), static_cast<std::streamsize>(str.size()));
+
+  auto const serialised = Clock::now();
+
+  auto const bytes = str.size();
+
+  // output buffer to screen
+  if (_vterm)
+  {
+    _vterm->write(str);
+    _ctx.perf.write = Clock::now() - serialised;
+  }
+  else if (writer)
+  {
+    // hand the frame to the writer thread
+    _writer.frames.back().id = ++_writer.pushed;
+
+    if (_writer.frames.push())
+    {
+      ++_ctx.perf.dropped;
+    }
+
+    {
+      std::lock_guard<std::mutex> lock {_writer.mutex};
+    }
+
+    _writer.cv.notify_all();
+
+    // write time of the last frame the terminal took
+    _ctx.perf.write = Clock::duration(_writer.write.load(std::memory_order_relaxed));
+  }
+  else
+  {
+    std::cout
+    << str
+    << std::flush;
+
+    _ctx.perf.write = Clock::now() - serialised;
+  }
+
+  _ctx.perf.serialise = serialised - begin;
 
   // clear output buffer
   _ctx.buf.str("");
+
+  perf_record(bytes);
+}
+
+void Tui::writer_start()
+{
+  _writer.stop = false;
+  _writer.thread = std::thread(&Tui::writer_loop, this);
+}
+
+void Tui::writer_stop()
+{
+  if (! _writer.thread.joinable())
+  {
+    return;
+  }
+
+  {
+    std::lock_guard<std::mutex> lock {_writer.mutex};
+    _writer.stop = true;
+  }
+
+  _writer.cv.notify_all();
+  _writer.thread.join();
+}
+
+void Tui::writer_loop()
+{
+  while (true)
+  {
+    {
+      std::unique_lock<std::mutex> lock {_writer.mutex};
+      _writer.cv.wait(lock, [&] { return _writer.stop || _writer.frames.ready(); });
+
+      // write the last frame before stopping
+      if (! _writer.frames.ready())
+      {
+        return;
+      }
+    }
+
+    _writer.frames.pull();
+    auto const& frame = _writer.frames.front();
+
+    auto const begin = Clock::now();
+
+    std::cout
+    << frame.str
+    << std::flush;
+
+    auto const time = (Clock::now() - begin).count();
+    auto const avg = _writer.write_avg.load(std::memory_order_relaxed);
+    _writer.write.store(time, std::memory_order_relaxed);
+    _writer.write_avg.store(avg + (time - avg) / 4, std::memory_order_relaxed);
+
+    {
+      std::lock_guard<std::mutex> lock {_writer.mutex};
+      _writer.written = frame.id;
+    }
+
+    _writer.cv.notify_all();
+  }
+}
+
+bool Tui::writer_behind()
+{
+  // the terminal is still busy with an earlier frame,
+  // and writes take longer than the current word is shown for
+  return _writer.thread.joinable() &&
+    _writer.written.load() != _writer.pushed &&
+    Clock::duration(_writer.write_avg.load(std::memory_order_relaxed)) >
+      _ctx.state.wait;
+}
+
+void Tui::drain()
+{
+  // wait for the writer thread to finish the frames handed to it,
+  // before writing to the terminal directly
+  if (! _writer.thread.joinable())
+  {
+    return;
+  }
+
+  std::unique_lock<std::mutex> lock {_writer.mutex};
+  _writer.cv.wait(lock, [&] { return _writer.written == _writer.pushed; });
+}
+
+void Tui::autosave_start()
+{
+  if (! autosave_enabled() || state_key().empty())
+  {
+    return;
+  }
+
+  _autosave.stop = false;
+  _autosave.next = Clock::now() + _autosave.interval;
+  _autosave.index = _fltrdr.get_index();
+  _autosave.thread = std::thread(&Tui::autosave_loop, this);
+}
+
+void Tui::autosave_stop()
+{
+  if (! _autosave.thread.joinable())
+  {
+    return;
+  }
+
+  {
+    std::lock_guard<std::mutex> lock {_autosave.mutex};
+    _autosave.stop = true;
+  }
+
+  _autosave.cv.notify_all();
+  _autosave.thread.join();
+}
+
+void Tui::autosave_loop()
+{
+  while (true)
+  {
+    std::pair<std::string, State> job;
+
+    {
+      std::unique_lock<std::mutex> lock {_autosave.mutex};
+      _autosave.cv.wait(lock, [&] { return _autosave.stop || _autosave.pending; });
+
+      // write the last checkpoint before stopping
+      if (! _autosave.pending)
+      {
+        return;
+      }
+
+      job = std::move(_autosave.pending.value());
+      _autosave.pending.reset();
+    }
+
+    write_state(job.first, job.second);
+  }
+}
+
+bool Tui::autosave_enabled()
+{
+  return _autosave.interval.count() || _autosave.words || _autosave.pause;
+}
+
+void Tui::autosave(bool const force)
+{
+  auto& as = _autosave;
+
+  if (! as.thread.joinable())
+  {
+    return;
+  }
+
+  auto const now = Clock::now();
+  auto const index = _fltrdr.get_index();
+  auto const moved = index > as.index ? index - as.index : as.index - index;
+
+  bool const due {as.interval.count() && now >= as.next};
+  bool const far {as.words && moved >= as.words};
+
+  if (! (force || due || far))
+  {
+    return;
+  }
+
+  auto const key = state_key();
+
+  if (key.empty())
+  {
+    return;
+  }
+
+  {
+    std::lock_guard<std::mutex> lock {as.mutex};
+    as.pending.emplace(key, get_state());
+  }
+
+  as.cv.notify_all();
+
+  as.next = now + as.interval;
+  as.index = index;
+}
+
+std::pair<double, double> Tui::calibrate()
+{
+  // render frames through the normal output path for about a second,
+  // waiting for each one to reach the terminal so none are dropped,
+  // returns the sustained frames per second and the words shown per frame
+  auto const index = _fltrdr.get_index();
+  auto const time = std::chrono::seconds(1);
+
+  std::size_t frames {0};
+  std::size_t words {0};
+
+  drain();
+
+  auto const begin = Clock::now();
+  auto end = begin;
+
+  while (end - begin < time)
+  {
+    auto const prev = _fltrdr.get_index();
+
+    if (_fltrdr.next_chunk())
+    {
+      words += _fltrdr.get_index() - prev;
+    }
+    else
+    {
+      _fltrdr.begin();
+    }
+
+    render();
+    drain();
+
+    ++frames;
+    end = Clock::now();
+  }
+
+  _fltrdr.set_index(index);
+
+  auto const secs = std::chrono::duration<double>(end - begin).count();
+
+  return {frames / secs, words ? words / static_cast<double>(frames) : 1.0};
+}
+
+void Tui::perf_record(std::size_t const bytes)
+{
+  auto& perf = _ctx.perf;
+
+  ++perf.frame;
+  perf.bytes = bytes;
+
+  if (perf.log.is_open())
+  {
+    auto const us = [](auto const val) {
+      return std::chrono::duration_cast<std::chrono::microseconds>(val).count();
+    };
+
+    perf.log
+    << perf.frame << " "
+    << us(Clock::now() - perf.begin) << " "
+    << us(perf.set_line) << " "
+    << us(perf.draw) << " "
+    << us(perf.serialise) << " "
+    << us(perf.write) << " "
+    << perf.bytes << " "
+    << us(perf.scheduled) << " "
+    << us(perf.actual) << " "
+    << perf.dropped << "\n";
+  }
+
+  // word timings only belong to the frame that showed the word
+  perf.scheduled = {};
+  perf.actual = {};
 }
 
 void Tui::draw()
@@ -443,6 +1172,42 @@ void Tui::draw()
   draw_status();
   draw_prompt_message();
   draw_keybuf();
+  draw_perf();
+}
+
+void Tui::draw_perf()
+{
+  if (! _ctx.perf.show)
+  {
+    return;
+  }
+
+  auto const us = [](auto const val) {
+    return std::to_string(std::chrono::duration_cast<std::chrono::microseconds>(val).count());
+  };
+
+  auto const& perf = _ctx.perf;
+
+  // timings are from the previous frame, the current one is still being built
+  std::string const str {
+    "line " + us(perf.set_line) + "us"
+    " draw " + us(perf.draw) + "us"
+    " ser " + us(perf.serialise) + "us"
+    " write " + us(perf.write) + "us"
+    " " + std::to_string(perf.bytes) + "B"
+    " drop " + std::to_string(perf.dropped) +
+    " word " + us(perf.actual) + "/" + us(perf.scheduled) + "us"
+    " wpm " + std::to_string(_fltrdr.get_wpm_avg()) + "/" + std::to_string(_fltrdr.get_wpm_target())};
+
+  _ctx.buf
+  << aec::cursor_save
+  << aec::cursor_set(0, 1)
+  << aec::erase_line
+  << _ctx.style.bg
+  << _ctx.style.secondary
+  << str.substr(0, _ctx.width)
+  << aec::clear
+  << aec::cursor_load;
 }
 
 void Tui::draw_content()
@@ -456,7 +1221,6 @@ void Tui::draw_content()
   {
     std::string before {};
     std::string value {};
-    std::string after {aec::clear};
   };
   using Buf = std::vector<Block>;
   Buf buf {_ctx.width, Block()};
@@ -622,13 +1386,23 @@ void Tui::draw_content()
   }
 
   // render line to buffer
+  // only emit a new style sequence when it differs from the previous cell
+  std::string style;
+  std::string style_prev;
+
   for (auto const& e : buf)
   {
-    _ctx.buf
-    << _ctx.style.bg
-    << e.before
-    << e.value
-    << e.after;
+    style = aec::clear;
+    style += _ctx.style.bg;
+    style += e.before;
+
+    if (style != style_prev)
+    {
+      _ctx.buf << style;
+      style_prev = style;
+    }
+
+    _ctx.buf << e.value;
   }
 
   _ctx.buf
@@ -699,10 +1473,8 @@ void Tui::draw_progress_bar()
 void Tui::draw_prompt_message()
 {
   // check if command prompt message is active
-  if (_ctx.prompt.count > 0)
+  if (Clock::now() < _ctx.prompt.expire)
   {
-    --_ctx.prompt.count;
-
     _ctx.buf
     << aec::cursor_save
     << aec::cursor_set(0, _ctx.height)
@@ -743,6 +1515,12 @@ void Tui::draw_status()
 
   // stats
   std::string stats {_fltrdr.get_stats()};
+
+  // frames the terminal could not keep up with
+  if (_ctx.perf.dropped)
+  {
+    stats = std::to_string(_ctx.perf.dropped) + "drop " + stats;
+  }
   int const len_stats {2 + static_cast<int>(stats.size())};
 
   // pad center
@@ -878,7 +1656,7 @@ void Tui::set_wait()
   {
     if (_ctx.state.counting_down)
     {
-      _ctx.state.wait = (60000 / _fltrdr.get_wpm());
+      _ctx.state.wait = std::chrono::microseconds(60000000 / _fltrdr.get_wpm());
     }
     else
     {
@@ -895,22 +1673,100 @@ void Tui::set_status(bool success, std::string const& msg)
 {
   _ctx.style.prompt_status = success ? _ctx.style.success : _ctx.style.error;
   _ctx.prompt.str = msg;
-  _ctx.prompt.count = _ctx.prompt.timeout;
+  _ctx.prompt.expire = Clock::now() + _ctx.prompt.timeout;
 }
 
-void Tui::get_input(int& wait)
+void Tui::set_color_depth(std::string const& val)
 {
-  while ((_ctx.key.val = OB::Term::get_key(&_ctx.key.str)) > 0)
+  _ctx.color_depth = val;
+
+  if (val == "24")
   {
-    _ctx.keys.emplace_back(_ctx.key);
+    OB::Color::depth(OB::Term::Depth::bit24);
+  }
+  else if (val == "8")
+  {
+    OB::Color::depth(OB::Term::Depth::bit8);
+  }
+  else if (val == "4")
+  {
+    OB::Color::depth(OB::Term::Depth::bit4);
+  }
+  else
+  {
+    OB::Color::depth(OB::Term::color_depth());
+  }
 
-    switch (_ctx.keys.at(0).val)
-    {
-      // quit
-      case 'q': case 'Q':
-      {
-        _ctx.is_running = false;
-        _ctx.keys.clear();
+  // re-quantise every configured colour for the new depth
+  auto& style = _ctx.style;
+
+  for (auto* color : {&style.bg, &style.primary, &style.secondary,
+    &style.background, &style.border, &style.countdown, &style.progress_bar,
+    &style.progress_fill, &style.prompt, &style.prompt_status, &style.success,
+    &style.error, &style.word_primary, &style.word_secondary,
+    &style.word_highlight, &style.word_punct, &style.word_quote})
+  {
+    color->update();
+  }
+}
+
+void Tui::get_input(std::chrono::microseconds& wait)
+{
+  // all keys read in one go are handled as a batch,
+  // word movement is summed and applied as a single jump,
+  // and the screen is rendered once at the end
+  long move {0};
+  bool dirty {false};
+
+  auto const jump = [&]() {
+    if (move)
+    {
+      auto const index = static_cast<long>(_fltrdr.get_index()) + move;
+      _fltrdr.set_index(static_cast<std::size_t>(std::max(index, 1L)));
+      move = 0;
+    }
+  };
+
+  auto const update = [&]() {
+    jump();
+
+    if (dirty)
+    {
+      render();
+      dirty = false;
+    }
+  };
+
+  while ((_ctx.key.val = OB::Term::get_key(&_ctx.key.str)) > 0)
+  {
+    _ctx.keys.emplace_back(_ctx.key);
+
+    switch (_ctx.keys.at(0).val)
+    {
+      case 'h': case OB::Term::Key::left:
+      case OB::Term::Mouse::scroll_up:
+      case 'l': case OB::Term::Key::right:
+      case OB::Term::Mouse::scroll_down:
+      {
+        break;
+      }
+
+      default:
+      {
+        // keep the order of movement and other keys
+        jump();
+
+        break;
+      }
+    }
+
+    switch (_ctx.keys.at(0).val)
+    {
+      // quit
+      case 'q': case 'Q':
+      {
+        _ctx.is_running = false;
+        _ctx.keys.clear();
 
         return;
       }
@@ -936,7 +1792,7 @@ void Tui::get_input(int& wait)
       {
         // pause
         pause();
-        _ctx.prompt.count = 0;
+        _ctx.prompt.expire = {};
         _ctx.keys.clear();
 
         break;
@@ -947,6 +1803,8 @@ void Tui::get_input(int& wait)
       {
         if (_ctx.keys.size() < 2)
         {
+          update();
+
           return;
         }
         else if (_ctx.keys.at(1).val == 'g')
@@ -980,8 +1838,9 @@ void Tui::get_input(int& wait)
         else
         {
           play();
-          wait = 0;
+          wait = wait.zero();
 
+          // rendered at the top of the event loop
           return;
         }
 
@@ -1061,7 +1920,7 @@ void Tui::get_input(int& wait)
       case OB::Term::Mouse::scroll_up:
       {
         pause();
-        _fltrdr.prev_word();
+        --move;
 
         break;
       }
@@ -1071,7 +1930,7 @@ void Tui::get_input(int& wait)
       case OB::Term::Mouse::scroll_down:
       {
         pause();
-        _fltrdr.next_word();
+        ++move;
 
         break;
       }
@@ -1141,6 +2000,7 @@ void Tui::get_input(int& wait)
       case ':':
       {
         pause();
+        update();
         command_prompt();
         _ctx.keys.clear();
 
@@ -1151,6 +2011,7 @@ void Tui::get_input(int& wait)
       case '/':
       {
         pause();
+        update();
         search_forward();
         _ctx.keys.clear();
 
@@ -1161,6 +2022,7 @@ void Tui::get_input(int& wait)
       case '?':
       {
         pause();
+        update();
         search_backward();
         _ctx.keys.clear();
 
@@ -1169,22 +2031,21 @@ void Tui::get_input(int& wait)
 
       default:
       {
-        // ignore
-        draw_keybuf();
-        refresh();
+        // ignore, show the key buffer
+        jump();
+        render();
         _ctx.keys.clear();
 
         return;
       }
     }
 
-    // render new content
-    _fltrdr.set_line(_ctx.offset);
-    clear();
-    draw();
-    refresh();
+    dirty = true;
     _ctx.keys.clear();
   }
+
+  // render new content
+  update();
 }
 
 void Tui::play()
@@ -1199,9 +2060,10 @@ void Tui::play()
 
   _ctx.state.counting_down = true;
   _ctx.state.count_down = _ctx.state.count_total;
+  _ctx.state.deadline = {};
 
-  // reset prompt message count
-  _ctx.prompt.count = 0;
+  // clear prompt message
+  _ctx.prompt.expire = {};
 }
 
 void Tui::pause()
@@ -1219,8 +2081,17 @@ void Tui::pause()
   _ctx.state.play = false;
   _ctx.status.mode = "PAUSE";
 
+  // don't count the pause towards the display time of the next word
+  _ctx.perf.word = {};
+  _ctx.state.deadline = {};
+
   _ctx.state.counting_down = false;
   _ctx.state.count_down = 0;
+
+  if (_autosave.pause)
+  {
+    autosave(true);
+  }
 }
 
 std::optional<std::pair<bool, std::string>> Tui::command(std::string const& input)
@@ -1238,107 +2109,208 @@ std::optional<std::pair<bool, std::string>> Tui::command(std::string const& inpu
     return {};
   }
 
-  auto const keys = OB::String::split(input, " ", 2);
+  // split on whitespace, keeping where each word starts
+  std::vector<std::string> words;
+  std::vector<std::size_t> begins;
+
+  for (std::size_t i = 0; i < input.size();)
+  {
+    if (input[i] == ' ' || input[i] == '\t')
+    {
+      ++i;
+      continue;
+    }
+
+    auto const end = input.find_first_of(" \t", i);
+    begins.emplace_back(i);
+    words.emplace_back(input.substr(i, end - i));
+    i = end == std::string::npos ? input.size() : end;
+  }
 
-  if (keys.empty())
+  if (words.empty())
   {
     return {};
   }
 
-  // store the matches returned from OB::String::match
-  std::optional<std::vector<std::string>> match_opt;
+  // a command name is one word, or two for commands with sub commands
+  std::size_t size {1};
+  auto it = _commands.end();
 
-  // quit
-  if (keys.size() == 1 && (keys.at(0) == "q" || keys.at(0) == "Q" ||
-    keys.at(0) == "quit" || keys.at(0) == "Quit" || keys.at(0) == "exit"))
+  if (words.size() > 1)
   {
-    _ctx.is_running = false;
-    return {};
+    it = _commands.find(words.at(0) + " " + words.at(1));
+    size = 2;
   }
 
-  // save state
-  else if (keys.size() == 1 && keys.at(0) == "w")
+  if (it == _commands.end())
   {
-    save_state();
+    it = _commands.find(words.at(0));
+    size = 1;
   }
 
-  // save state and quit
-  else if (keys.size() == 1 && keys.at(0) == "wq")
+  if (it == _commands.end())
   {
-    save_state();
-    _ctx.is_running = false;
-    return {};
+    return unknown(input);
   }
 
-  else if (keys.at(0) == "prev" && (match_opt = OB::String::match(input,
-    std::regex("^prev(?:\\s+([0-9]{1,2}))?$"))))
+  Args args;
+  args.input = input;
+  args.argv.assign(words.begin() + static_cast<std::ptrdiff_t>(size), words.end());
+
+  if (size < begins.size())
   {
-    auto const match = match_opt.value().at(1);
+    args.str = input.substr(begins.at(size));
+  }
 
-    if (match.empty())
-    {
-      return std::make_pair(true, "prev " + std::to_string(_fltrdr.get_show_prev()));
-    }
-    else
-    {
-      auto const val = std::stoi(match);
+  return it->second(args);
+}
 
-      if (val < 0 || val > 60)
-      {
-        return std::make_pair(false, "error: value '" + std::to_string(val) + "' is out of range <0-60>");
-      }
+std::pair<bool, std::string> Tui::unknown(std::string const& input)
+{
+  return std::make_pair(false, "warning: unknown command '" + input + "'");
+}
 
-      _fltrdr.set_show_prev(val);
-    }
+bool Tui::is_uint(std::string const& str, std::size_t const digits)
+{
+  return ! str.empty() && str.size() <= digits &&
+    std::all_of(str.begin(), str.end(), [](auto const ch) { return ch >= '0' && ch <= '9'; });
+}
+
+std::optional<bool> Tui::to_bool(std::string const& str)
+{
+  if (str == "true" || str == "t" || str == "1" || str == "on")
+  {
+    return true;
+  }
+
+  if (str == "false" || str == "f" || str == "0" || str == "off")
+  {
+    return false;
+  }
+
+  return {};
+}
+
+bool Tui::is_sym(std::string const& str)
+{
+  if (str.size() > 4)
+  {
+    return false;
   }
 
-  else if (keys.at(0) == "next" && (match_opt = OB::String::match(input,
-    std::regex("^next(?:\\s+([0-9]{1,2}))?$"))))
+  OB::Text::View view {str};
+
+  return view.size() == 1 && view.cols() <= 1 &&
+    OB::Text::is_graph(OB::Text::to_int32(view.front()));
+}
+
+void Tui::commands_init()
+{
+  auto& cmd = _commands;
+
+  // quit
+  for (auto const& name : {"q", "Q", "quit", "Quit", "exit"})
   {
-    auto const match = match_opt.value().at(1);
+    cmd[name] = [this](Args const& args) -> Result {
+      if (! args.argv.empty())
+      {
+        return unknown(args.input);
+      }
+
+      _ctx.is_running = false;
 
-    if (match.empty())
+      return {};
+    };
+  }
+
+  // save state
+  cmd["w"] = [this](Args const& args) -> Result {
+    if (! args.argv.empty())
     {
-      return std::make_pair(true, "next " + std::to_string(_fltrdr.get_show_next()));
+      return unknown(args.input);
     }
-    else
+
+    save_state();
+
+    return {};
+  };
+
+  // save state and quit
+  cmd["wq"] = [this](Args const& args) -> Result {
+    if (! args.argv.empty())
     {
-      auto const val = std::stoi(match);
+      return unknown(args.input);
+    }
+
+    save_state();
+    _ctx.is_running = false;
+
+    return {};
+  };
+
+  // number of words shown either side of the current word
+  auto const show = [&](std::string const& name, auto const get, auto const set) {
+    cmd[name] = [this, name, get, set](Args const& args) -> Result {
+      if (args.argv.empty())
+      {
+        return std::make_pair(true, name + " " + std::to_string((_fltrdr.*get)()));
+      }
+
+      if (args.argv.size() > 1 || ! is_uint(args.argv.at(0), 2))
+      {
+        return unknown(args.input);
+      }
+
+      auto const val = std::stoi(args.argv.at(0));
 
       if (val < 0 || val > 60)
       {
         return std::make_pair(false, "error: value '" + std::to_string(val) + "' is out of range <0-60>");
       }
 
-      _fltrdr.set_show_next(val);
-    }
-  }
+      (_fltrdr.*set)(val);
 
-  else if (keys.at(0) == "timer" && (match_opt = OB::String::match(input,
-    std::regex("^timer(?:\\s+(clear|(?:(?:\\d+Y:)?(?:\\d+M:)?(?:\\d+W:)?(?:\\d+D:)?(?:\\d+h:)?(?:\\d+m:)?(?:\\d+s))))?$"))))
-  {
-    auto const match = OB::String::trim(match_opt.value().at(1));
+      return {};
+    };
+  };
+
+  show("prev", &Fltrdr::get_show_prev, &Fltrdr::set_show_prev);
+  show("next", &Fltrdr::get_show_next, &Fltrdr::set_show_next);
 
-    if (match.empty())
+  cmd["timer"] = [this](Args const& args) -> Result {
+    static std::regex const rx {"^(?:\\d+Y:)?(?:\\d+M:)?(?:\\d+W:)?(?:\\d+D:)?(?:\\d+h:)?(?:\\d+m:)?(?:\\d+s)$"};
+
+    if (args.argv.empty())
     {
       return std::make_pair(true, "timer " + _fltrdr.timer.str());
     }
 
-    if (match == "clear")
+    if (args.argv.size() > 1)
+    {
+      return unknown(args.input);
+    }
+
+    auto const& val = args.argv.at(0);
+
+    if (val == "clear")
     {
       _fltrdr.reset_timer();
     }
+    else if (std::regex_match(val, rx))
+    {
+      _fltrdr.timer.str(val);
+    }
     else
     {
-      _fltrdr.timer.str(match);
+      return unknown(args.input);
     }
-  }
+
+    return {};
+  };
 
   // open
-  else if (keys.at(0) == "open" && (match_opt = OB::String::match(input,
-    std::regex("^open(?:\\s+([^\\r]+))?$"))))
-  {
-    fs::path const path = std::move(match_opt.value().at(1));
+  cmd["open"] = [this](Args const& args) -> Result {
+    fs::path const path = args.str;
 
     if (path.empty())
     {
@@ -1356,6 +2328,12 @@ std::optional<std::pair<bool, std::string>> Tui::command(std::string const& inpu
       return std::make_pair(false, "error: could not open file '" + path.string() + "'");
     }
 
+    // checkpoint the document being left
+    if (autosave_enabled())
+    {
+      autosave(true);
+    }
+
     if (_fltrdr.parse(file))
     {
       _ctx.file.path = path;
@@ -1363,886 +2341,762 @@ std::optional<std::pair<bool, std::string>> Tui::command(std::string const& inpu
     }
 
     load_state();
-  }
 
-  // set wpm
-  else if (keys.at(0) == "wpm" && (match_opt = OB::String::match(input,
-    std::regex("^wpm(?:\\s+([0-9]+))?$"))))
-  {
-    auto const match = std::move(match_opt.value().at(1));
+    return {};
+  };
 
-    if (match.empty())
+  // write the state as commands
+  cmd["state export"] = [this](Args const& args) -> Result {
+    if (args.str.empty())
     {
-      return std::make_pair(true, "wpm " + std::to_string(_fltrdr.get_wpm()));
+      return unknown(args.input);
     }
 
-    _fltrdr.set_wpm(std::stoi(match));
-  }
+    if (! export_state(args.str))
+    {
+      return std::make_pair(false, "error: could not write file '" + args.str + "'");
+    }
 
-  // set wpm-avg
-  else if (keys.at(0) == "wpm-avg" && (match_opt = OB::String::match(input,
-    std::regex("^wpm-avg(?:\\s+([0-9]+|clear))?$"))))
-  {
-    auto const match = std::move(match_opt.value().at(1));
+    return std::make_pair(true, "exported state to '" + args.str + "'");
+  };
 
-    if (match.empty())
+  // run the commands in a state file
+  cmd["state import"] = [this](Args const& args) -> Result {
+    if (args.str.empty())
     {
-      return std::make_pair(true, "wpm-avg " + std::to_string(_fltrdr.get_wpm_avg()));
+      return unknown(args.input);
     }
 
-    if (match == "clear")
+    if (! import_state(args.str))
     {
-      _fltrdr.reset_wpm_avg();
+      return std::make_pair(false, "error: could not open file '" + args.str + "'");
     }
-    else
+
+    return std::make_pair(true, "imported state from '" + args.str + "'");
+  };
+
+  // autosave interval in seconds
+  cmd["autosave"] = [this](Args const& args) -> Result {
+    if (args.argv.empty())
     {
-      _fltrdr.set_wpm_avg(std::stoi(match));
+      return std::make_pair(true, "autosave " + std::to_string(_autosave.interval.count()));
     }
-  }
-
-  // goto word
-  else if (keys.at(0) == "goto" && (match_opt = OB::String::match(input,
-    std::regex("^goto(?:\\s+([0-9]+))?$"))))
-  {
-    auto const match = std::move(match_opt.value().at(1));
 
-    if (match.empty())
+    if (args.argv.size() > 1 || ! is_uint(args.argv.at(0), 6))
     {
-      return std::make_pair(true, "goto " + std::to_string(_fltrdr.get_index()));
+      return unknown(args.input);
     }
 
-    _fltrdr.set_index(std::stoul(match));
-  }
+    _autosave.interval = std::chrono::seconds(std::stoi(args.argv.at(0)));
+    _autosave.next = Clock::now() + _autosave.interval;
 
-  // set offset
-  else if (keys.at(0) == "offset" && (match_opt = OB::String::match(input,
-    std::regex("^offset(?:\\s+([0-6]{1}))?$"))))
-  {
-    auto const match = std::move(match_opt.value().at(1));
+    return {};
+  };
 
-    if (match.empty())
+  // autosave after moving a number of words
+  cmd["autosave-words"] = [this](Args const& args) -> Result {
+    if (args.argv.empty())
     {
-      return std::make_pair(true, "offset " + std::to_string(_ctx.offset_value));
+      return std::make_pair(true, "autosave-words " + std::to_string(_autosave.words));
     }
 
-    _ctx.offset_value = std::stoi(match);
-  }
-
-  else if (keys.size() >= 2 && keys.at(0) == "style")
-  {
-    // two-tone primary color
-    if (keys.at(1) == "primary")
+    if (args.argv.size() > 1 || ! is_uint(args.argv.at(0), 9))
     {
-      if (keys.size() < 3)
-      {
-        return std::make_pair(true, "style primary " + _ctx.style.secondary.key());
-      }
+      return unknown(args.input);
+    }
 
-      OB::Color color {keys.at(2)};
+    _autosave.words = std::stoul(args.argv.at(0));
 
-      if (! color)
-      {
-        return std::make_pair(false, "warning: unknown command '" + input + "'");
-      }
+    return {};
+  };
 
-      _ctx.style.secondary = color;
-      _ctx.style.border = color;
-      _ctx.style.progress_fill = color;
-      _ctx.style.word_primary = color;
-      _ctx.style.prompt = color;
-      _ctx.style.background = color.bg();
+  // autosave on pause
+  cmd["autosave-pause"] = [this](Args const& args) -> Result {
+    if (args.argv.empty())
+    {
+      return std::make_pair(true, "autosave-pause " + std::to_string(static_cast<int>(_autosave.pause)));
     }
 
-    // two-tone secondary color
-    else if (keys.at(1) == "secondary")
+    auto const val = to_bool(args.argv.at(0));
+
+    if (args.argv.size() > 1 || ! val)
     {
-      if (keys.size() < 3)
-      {
-        return std::make_pair(true, "style secondary " + _ctx.style.primary.key());
-      }
+      return unknown(args.input);
+    }
 
-      OB::Color color {keys.at(2)};
+    _autosave.pause = val.value();
 
-      if (! color)
-      {
-        return std::make_pair(false, "warning: unknown command '" + input + "'");
-      }
+    return {};
+  };
 
-      _ctx.style.primary = color;
-      _ctx.style.progress_bar = color;
-      _ctx.style.word_secondary = color;
-      _ctx.style.word_highlight = color;
-      _ctx.style.word_punct = color;
-      _ctx.style.word_quote = color;
+  // number of states kept in the store
+  cmd["state-keep"] = [this](Args const& args) -> Result {
+    if (args.argv.empty())
+    {
+      return std::make_pair(true, "state-keep " + std::to_string(_retain.count));
     }
 
-    // text color
-    else if (keys.at(1) == "text")
+    if (args.argv.size() > 1 || ! is_uint(args.argv.at(0), 9))
     {
-      if (keys.size() < 3)
-      {
-        return std::make_pair(true, "style text " + _ctx.style.word_primary.key());
-      }
+      return unknown(args.input);
+    }
 
-      OB::Color color {keys.at(2)};
+    _retain.count = std::stoul(args.argv.at(0));
 
-      if (! color)
-      {
-        return std::make_pair(false, "warning: unknown command '" + input + "'");
-      }
+    return {};
+  };
 
-      _ctx.style.word_primary = color;
-      _ctx.style.word_secondary = color;
-      _ctx.style.word_highlight = color;
-      _ctx.style.word_punct = color;
-      _ctx.style.word_quote = color;
+  // days a state is kept in the store after it was saved
+  cmd["state-age"] = [this](Args const& args) -> Result {
+    if (args.argv.empty())
+    {
+      return std::make_pair(true, "state-age " + std::to_string(_retain.age.count() / 86400));
     }
 
-    else if (keys.at(1) == "status-background")
+    if (args.argv.size() > 1 || ! is_uint(args.argv.at(0), 5))
     {
-      if (keys.size() < 3)
-      {
-        return std::make_pair(true, "style status-background " + _ctx.style.background.key());
-      }
+      return unknown(args.input);
+    }
 
-      OB::Color color {keys.at(2), OB::Color::Type::bg};
+    _retain.age = std::chrono::seconds(std::stol(args.argv.at(0)) * 86400);
 
-      if (! color)
-      {
-        return std::make_pair(false, "warning: unknown command '" + input + "'");
-      }
+    return {};
+  };
 
-      _ctx.style.background = color;
+  // number of entries kept in the command and search history
+  cmd["history-size"] = [this](Args const& args) -> Result {
+    if (args.argv.empty())
+    {
+      return std::make_pair(true, "history-size " + std::to_string(_readline.hist_size()));
     }
 
-    else if (keys.at(1) == "background")
+    if (args.argv.size() > 1 || ! is_uint(args.argv.at(0), 9))
     {
-      if (keys.size() < 3)
-      {
-        return std::make_pair(true, "style background " + _ctx.style.bg.key());
-      }
+      return unknown(args.input);
+    }
 
-      OB::Color color {keys.at(2), OB::Color::Type::bg};
+    auto const size = std::stoul(args.argv.at(0));
+    _readline.hist_size(size);
+    _readline_search.hist_size(size);
 
-      if (! color)
-      {
-        return std::make_pair(false, "warning: unknown command '" + input + "'");
-      }
+    return {};
+  };
 
-      _ctx.style.bg = color;
+  // summary of the state store
+  cmd["state list"] = [this](Args const& args) -> Result {
+    if (! args.argv.empty())
+    {
+      return unknown(args.input);
     }
 
-    else if (keys.at(1) == "countdown")
+    if (! _store.is_open())
     {
-      if (keys.size() < 3)
-      {
-        return std::make_pair(true, "style countdown " + _ctx.style.countdown.key());
-      }
+      return std::make_pair(false, "error: state store is not open");
+    }
 
-      OB::Color color {keys.at(2), OB::Color::Type::bg};
+    auto const entries = _store.list();
 
-      if (! color)
+    std::string res {"state " + std::to_string(entries.size()) + " entries, " +
+      std::to_string(_store.live()) + "/" + std::to_string(_store.size()) + " bytes live"};
+
+    if (! entries.empty())
+    {
+      State state;
+
+      if (auto const val = _store.get(entries.front().key); val && state.str(val.value()) && ! state.file.empty())
       {
-        return std::make_pair(false, "warning: unknown command '" + input + "'");
+        res += ", newest '" + state.file + "'";
       }
+    }
 
-      _ctx.style.countdown = color;
+    return std::make_pair(true, res);
+  };
+
+  // trim the state store now
+  cmd["state gc"] = [this](Args const& args) -> Result {
+    if (! args.argv.empty())
+    {
+      return unknown(args.input);
     }
 
-    else if (keys.at(1) == "status-primary")
+    if (! _store.is_open())
     {
-      if (keys.size() < 3)
-      {
-        return std::make_pair(true, "style status-primary " + _ctx.style.primary.key());
-      }
+      return std::make_pair(false, "error: state store is not open");
+    }
 
-      OB::Color color {keys.at(2)};
+    auto const removed = _store.gc(_retain.count, _retain.age, true);
 
-      if (! color)
-      {
-        return std::make_pair(false, "warning: unknown command '" + input + "'");
-      }
+    return std::make_pair(true, "state gc removed " + std::to_string(removed) +
+      ", " + std::to_string(_store.size()) + " bytes");
+  };
 
-      _ctx.style.primary = color;
+  // set wpm
+  cmd["wpm"] = [this](Args const& args) -> Result {
+    if (args.argv.empty())
+    {
+      return std::make_pair(true, "wpm " + std::to_string(_fltrdr.get_wpm()));
     }
 
-    else if (keys.at(1) == "status-secondary")
+    if (args.argv.size() > 1 || ! is_uint(args.argv.at(0), 9))
     {
-      if (keys.size() < 3)
-      {
-        return std::make_pair(true, "style status-secondary " + _ctx.style.secondary.key());
-      }
+      return unknown(args.input);
+    }
 
-      OB::Color color {keys.at(2)};
+    _fltrdr.set_wpm(std::stoi(args.argv.at(0)));
 
-      if (! color)
-      {
-        return std::make_pair(false, "warning: unknown command '" + input + "'");
-      }
-
-      _ctx.style.secondary = color;
-    }
+    return {};
+  };
 
-    else if (keys.at(1) == "border")
-    {
-      if (keys.size() < 3)
+  // set wpm limits and step
+  auto const wpm_limit = [&](std::string const& name, auto const get, auto const set) {
+    cmd[name] = [this, name, get, set](Args const& args) -> Result {
+      if (args.argv.empty())
       {
-        return std::make_pair(true, "style border " + _ctx.style.border.key());
+        return std::make_pair(true, name + " " + std::to_string((_fltrdr.*get)()));
       }
 
-      OB::Color color {keys.at(2)};
-
-      if (! color)
+      if (args.argv.size() > 1 || ! is_uint(args.argv.at(0), 6))
       {
-        return std::make_pair(false, "warning: unknown command '" + input + "'");
+        return unknown(args.input);
       }
 
-      _ctx.style.border = color;
-    }
-
-    else if (keys.at(1) == "progress-bar")
-    {
-      if (keys.size() < 3)
+      if (! (_fltrdr.*set)(std::stoi(args.argv.at(0))))
       {
-        return std::make_pair(true, "style progress-bar " + _ctx.style.progress_bar.key());
+        return std::make_pair(false, "error: value '" + args.argv.at(0) + "' is out of range for " + name);
       }
 
-      OB::Color color {keys.at(2)};
+      return {};
+    };
+  };
 
-      if (! color)
-      {
-        return std::make_pair(false, "warning: unknown command '" + input + "'");
-      }
+  wpm_limit("wpm-min", &Fltrdr::get_wpm_min, &Fltrdr::set_wpm_min);
+  wpm_limit("wpm-max", &Fltrdr::get_wpm_max, &Fltrdr::set_wpm_max);
+  wpm_limit("wpm-step", &Fltrdr::get_wpm_step, &Fltrdr::set_wpm_step);
 
-      _ctx.style.progress_bar = color;
+  // measure the frame rate the terminal sustains
+  cmd["calibrate"] = [this](Args const& args) -> Result {
+    if (! args.argv.empty())
+    {
+      return unknown(args.input);
     }
 
-    else if (keys.at(1) == "progress-fill")
+    if (_ctx.width < _ctx.width_min || _ctx.height < _ctx.height_min)
     {
-      if (keys.size() < 3)
-      {
-        return std::make_pair(true, "style progress-fill " + _ctx.style.progress_fill.key());
-      }
-
-      OB::Color color {keys.at(2)};
-
-      if (! color)
-      {
-        return std::make_pair(false, "warning: unknown command '" + input + "'");
-      }
-
-      _ctx.style.progress_fill = color;
+      return std::make_pair(false, "error: calibrate needs the screen to be shown");
     }
 
-    else if (keys.at(1) == "prompt")
-    {
-      if (keys.size() < 3)
-      {
-        return std::make_pair(true, "style prompt " + _ctx.style.prompt.key());
-      }
+    auto const [fps, words] = calibrate();
 
-      OB::Color color {keys.at(2)};
+    // every timing model shows a word for at least the time per word at the set wpm,
+    // so one frame per flash is the most the display can deliver
+    auto const wpm = static_cast<int>(fps * 60.0 * words);
 
-      if (! color)
-      {
-        return std::make_pair(false, "warning: unknown command '" + input + "'");
-      }
+    return std::make_pair(true, "calibrate " + std::to_string(static_cast<int>(fps)) + "fps, max " +
+      std::to_string(wpm) + "wpm at chunk " + std::to_string(_fltrdr.get_chunk()) +
+      (_fltrdr.get_chunk_cols() ? " cols " + std::to_string(_fltrdr.get_chunk_cols()) : ""));
+  };
 
-      _ctx.style.prompt = color;
+  // set word timing model
+  cmd["timing"] = [this](Args const& args) -> Result {
+    if (args.argv.empty())
+    {
+      return std::make_pair(true, "timing " + _fltrdr.get_timing());
     }
 
-    else if (keys.at(1) == "success")
+    if (args.argv.size() > 1 || ! _fltrdr.set_timing(args.argv.at(0)))
     {
-      if (keys.size() < 3)
-      {
-        return std::make_pair(true, "style success " + _ctx.style.success.key());
-      }
+      return unknown(args.input);
+    }
 
-      OB::Color color {keys.at(2)};
+    return {};
+  };
 
-      if (! color)
+  // set words or display columns shown per flash
+  auto const chunk = [&](std::string const& name, int const max, auto const get, auto const set) {
+    cmd[name] = [this, name, max, get, set](Args const& args) -> Result {
+      if (args.argv.empty())
       {
-        return std::make_pair(false, "warning: unknown command '" + input + "'");
+        return std::make_pair(true, name + " " + std::to_string((_fltrdr.*get)()));
       }
 
-      _ctx.style.success = color;
-    }
-
-    else if (keys.at(1) == "error")
-    {
-      if (keys.size() < 3)
+      if (args.argv.size() > 1 || ! is_uint(args.argv.at(0), std::to_string(max).size()))
       {
-        return std::make_pair(true, "style error " + _ctx.style.error.key());
+        return unknown(args.input);
       }
 
-      OB::Color color {keys.at(2)};
+      auto const val = std::stoi(args.argv.at(0));
+      auto const min = name == "chunk" ? 1 : 0;
 
-      if (! color)
+      if (val < min || val > max)
       {
-        return std::make_pair(false, "warning: unknown command '" + input + "'");
+        return std::make_pair(false, "error: value '" + std::to_string(val) + "' is out of range <" +
+          std::to_string(min) + "-" + std::to_string(max) + ">");
       }
 
-      _ctx.style.error = color;
-    }
+      (_fltrdr.*set)(val);
 
-    else if (keys.at(1) == "text-primary")
-    {
-      if (keys.size() < 3)
-      {
-        return std::make_pair(true, "style text-primary " + _ctx.style.word_primary.key());
-      }
-
-      OB::Color color {keys.at(2)};
-
-      if (! color)
-      {
-        return std::make_pair(false, "warning: unknown command '" + input + "'");
-      }
+      return {};
+    };
+  };
 
-      _ctx.style.word_primary = color;
-    }
+  chunk("chunk", 20, &Fltrdr::get_chunk, &Fltrdr::set_chunk);
+  chunk("chunk-cols", 200, &Fltrdr::get_chunk_cols, &Fltrdr::set_chunk_cols);
 
-    else if (keys.at(1) == "text-secondary")
+  // set wpm-avg
+  cmd["wpm-avg"] = [this](Args const& args) -> Result {
+    if (args.argv.empty())
     {
-      if (keys.size() < 3)
-      {
-        return std::make_pair(true, "style text-secondary " + _ctx.style.word_secondary.key());
-      }
-
-      OB::Color color {keys.at(2)};
+      return std::make_pair(true, "wpm-avg " + std::to_string(_fltrdr.get_wpm_avg()) +
+        " (target " + std::to_string(_fltrdr.get_wpm_target()) + ")");
+    }
 
-      if (! color)
-      {
-        return std::make_pair(false, "warning: unknown command '" + input + "'");
-      }
+    auto const& val = args.argv.at(0);
 
-      _ctx.style.word_secondary = color;
+    if (args.argv.size() > 1 || (val != "clear" && ! is_uint(val, 9)))
+    {
+      return unknown(args.input);
     }
 
-    else if (keys.at(1) == "text-highlight")
+    if (val == "clear")
     {
-      if (keys.size() < 3)
-      {
-        return std::make_pair(true, "style text-highlight " + _ctx.style.word_highlight.key());
-      }
-
-      OB::Color color {keys.at(2)};
-
-      if (! color)
-      {
-        return std::make_pair(false, "warning: unknown command '" + input + "'");
-      }
-
-      _ctx.style.word_highlight = color;
+      _fltrdr.reset_wpm_avg();
     }
-
-    else if (keys.at(1) == "text-punct")
+    else
     {
-      if (keys.size() < 3)
-      {
-        return std::make_pair(true, "style text-punct " + _ctx.style.word_punct.key());
-      }
-
-      OB::Color color {keys.at(2)};
+      _fltrdr.set_wpm_avg(std::stoi(val));
+    }
 
-      if (! color)
-      {
-        return std::make_pair(false, "warning: unknown command '" + input + "'");
-      }
+    return {};
+  };
 
-      _ctx.style.word_punct = color;
+  // goto word
+  cmd["goto"] = [this](Args const& args) -> Result {
+    if (args.argv.empty())
+    {
+      return std::make_pair(true, "goto " + std::to_string(_fltrdr.get_index()));
     }
 
-    else if (keys.at(1) == "text-quote")
+    if (args.argv.size() > 1 || ! is_uint(args.argv.at(0), 18))
     {
-      if (keys.size() < 3)
-      {
-        return std::make_pair(true, "style text-quote " + _ctx.style.word_quote.key());
-      }
+      return unknown(args.input);
+    }
 
-      OB::Color color {keys.at(2)};
+    _fltrdr.set_index(std::stoul(args.argv.at(0)));
 
-      if (! color)
-      {
-        return std::make_pair(false, "warning: unknown command '" + input + "'");
-      }
-
-      _ctx.style.word_quote = color;
-    }
+    return {};
+  };
 
-    else
+  // set offset
+  cmd["offset"] = [this](Args const& args) -> Result {
+    if (args.argv.empty())
     {
-      return std::make_pair(false, "warning: unknown command '" + input + "'");
+      return std::make_pair(true, "offset " + std::to_string(_ctx.offset_value));
     }
-  }
 
-  else if (keys.size() >= 2 && keys.at(0) == "set")
-  {
-    if (match_opt = OB::String::match(input,
-      std::regex("^set\\s+view(?:\\s+(true|false|t|f|1|0|on|off))?$")))
+    if (args.argv.size() > 1 || ! is_uint(args.argv.at(0), 1) || args.argv.at(0) > "6")
     {
-      auto const match = match_opt.value().at(1);
-
-      if (match.empty())
-      {
-        return std::make_pair(true, "set view " + std::to_string(static_cast<int>(_fltrdr.get_show_line())));
-      }
-      else if ("true" == match || "t" == match || "1" == match || "on" == match)
-      {
-        _fltrdr.set_show_line(true);
-      }
-      else
-      {
-        _fltrdr.set_show_line(false);
-      }
+      return unknown(args.input);
     }
 
-    else if (match_opt = OB::String::match(input,
-      std::regex("^set\\s+progress(?:\\s+(true|false|t|f|1|0|on|off))?$")))
-    {
-      auto const match = match_opt.value().at(1);
+    _ctx.offset_value = std::stoi(args.argv.at(0));
+    _ctx.relayout = true;
 
-      if (match.empty())
-      {
-        return std::make_pair(true, "set progress " + std::to_string(static_cast<int>(_ctx.show.progress)));
-      }
-      else if ("true" == match || "t" == match || "1" == match || "on" == match)
-      {
-        _ctx.show.progress = true;
-      }
-      else
-      {
-        _ctx.show.progress = false;
-      }
-    }
+    return {};
+  };
 
-    else if (match_opt = OB::String::match(input,
-      std::regex("^set\\s+status(?:\\s+(true|false|t|f|1|0|on|off))?$")))
+  // set output colour depth
+  cmd["color-depth"] = [this](Args const& args) -> Result {
+    if (args.argv.empty())
     {
-      auto const match = match_opt.value().at(1);
-
-      if (match.empty())
-      {
-        return std::make_pair(true, "set status " + std::to_string(static_cast<int>(_ctx.show.status)));
-      }
-      else if ("true" == match || "t" == match || "1" == match || "on" == match)
-      {
-        _ctx.show.status = true;
-      }
-      else
-      {
-        _ctx.show.status = false;
-      }
+      return std::make_pair(true, "color-depth " + _ctx.color_depth);
     }
 
-    else if (match_opt = OB::String::match(input,
-      std::regex("^set\\s+border(?:\\s+(true|false|t|f|1|0|on|off))?$")))
-    {
-      auto const match = match_opt.value().at(1);
-
-      if (match.empty())
-      {
-        return std::make_pair(true, "set border " + std::to_string(static_cast<int>(_ctx.show.border_top && _ctx.show.border_bottom)));
-      }
-      else if ("true" == match || "t" == match || "1" == match || "on" == match)
-      {
-        _ctx.show.border_top = true;
-        _ctx.show.border_bottom = true;
-      }
-      else
-      {
-        _ctx.show.border_top = false;
-        _ctx.show.border_bottom = false;
-      }
-    }
+    auto const& val = args.argv.at(0);
 
-    else if (match_opt = OB::String::match(input,
-      std::regex("^set\\s+border\\-top(?:\\s+(true|false|t|f|1|0|on|off))?$")))
+    if (args.argv.size() > 1 || ! (val == "auto" || val == "24" || val == "8" || val == "4"))
     {
-      auto const match = match_opt.value().at(1);
-
-      if (match.empty())
-      {
-        return std::make_pair(true, "set border-top " + std::to_string(static_cast<int>(_ctx.show.border_top)));
-      }
-      else if ("true" == match || "t" == match || "1" == match || "on" == match)
-      {
-        _ctx.show.border_top = true;
-      }
-      else
-      {
-        _ctx.show.border_top = false;
-      }
+      return unknown(args.input);
     }
 
-    else if (match_opt = OB::String::match(input,
-      std::regex("^set\\s+border\\-bottom(?:\\s+(true|false|t|f|1|0|on|off))?$")))
-    {
-      auto const match = match_opt.value().at(1);
+    set_color_depth(val);
 
-      if (match.empty())
-      {
-        return std::make_pair(true, "set border-bottom " + std::to_string(static_cast<int>(_ctx.show.border_bottom)));
-      }
-      else if ("true" == match || "t" == match || "1" == match || "on" == match)
-      {
-        _ctx.show.border_bottom = true;
-      }
-      else
-      {
-        _ctx.show.border_bottom = false;
-      }
-    }
+    return {};
+  };
 
-    else
-    {
-      return std::make_pair(false, "warning: unknown command '" + input + "'");
-    }
-  }
+  // colours, the first one is shown when queried and all of them are set
+  using Color = OB::Color Ctx::Style::*;
 
-  else if (keys.size() >= 2 && keys.at(0) == "sym")
+  struct Style
   {
-    if (match_opt = OB::String::match(input,
-      std::regex("^sym\\s+progress(?:\\s+(.{0,4}))?$")))
-    {
-      auto const match = match_opt.value().at(1);
+    char const* name;
+    OB::Color::Type::value type;
+    std::vector<Color> colors;
+  };
 
-      if (match.empty())
-      {
-        return std::make_pair(true, "sym progress " +
-          (_ctx.sym.progress_bar == " " ? "clear" : _ctx.sym.progress_bar));
-      }
+  std::vector<Style> const styles {
+    // two-tone primary color, also sets the status background below
+    {"primary", OB::Color::Type::fg, {&Ctx::Style::secondary, &Ctx::Style::border,
+      &Ctx::Style::progress_fill, &Ctx::Style::word_primary, &Ctx::Style::prompt}},
+    // two-tone secondary color
+    {"secondary", OB::Color::Type::fg, {&Ctx::Style::primary, &Ctx::Style::progress_bar,
+      &Ctx::Style::word_secondary, &Ctx::Style::word_highlight, &Ctx::Style::word_punct,
+      &Ctx::Style::word_quote}},
+    // text color
+    {"text", OB::Color::Type::fg, {&Ctx::Style::word_primary, &Ctx::Style::word_secondary,
+      &Ctx::Style::word_highlight, &Ctx::Style::word_punct, &Ctx::Style::word_quote}},
+    {"status-background", OB::Color::Type::bg, {&Ctx::Style::background}},
+    {"background", OB::Color::Type::bg, {&Ctx::Style::bg}},
+    {"countdown", OB::Color::Type::bg, {&Ctx::Style::countdown}},
+    {"status-primary", OB::Color::Type::fg, {&Ctx::Style::primary}},
+    {"status-secondary", OB::Color::Type::fg, {&Ctx::Style::secondary}},
+    {"border", OB::Color::Type::fg, {&Ctx::Style::border}},
+    {"progress-bar", OB::Color::Type::fg, {&Ctx::Style::progress_bar}},
+    {"progress-fill", OB::Color::Type::fg, {&Ctx::Style::progress_fill}},
+    {"prompt", OB::Color::Type::fg, {&Ctx::Style::prompt}},
+    {"success", OB::Color::Type::fg, {&Ctx::Style::success}},
+    {"error", OB::Color::Type::fg, {&Ctx::Style::error}},
+    {"text-primary", OB::Color::Type::fg, {&Ctx::Style::word_primary}},
+    {"text-secondary", OB::Color::Type::fg, {&Ctx::Style::word_secondary}},
+    {"text-highlight", OB::Color::Type::fg, {&Ctx::Style::word_highlight}},
+    {"text-punct", OB::Color::Type::fg, {&Ctx::Style::word_punct}},
+    {"text-quote", OB::Color::Type::fg, {&Ctx::Style::word_quote}},
+  };
 
-      if (match == "clear")
+  for (auto const& e : styles)
+  {
+    cmd["style "s + e.name] = [this, name = std::string(e.name), type = e.type, colors = e.colors](Args const& args) -> Result {
+      if (args.str.empty())
       {
-        _ctx.sym.progress_bar = " ";
-        _ctx.sym.progress_fill = " ";
-
-        return {};
+        return std::make_pair(true, "style " + name + " " + (_ctx.style.*colors.front()).key());
       }
 
-      OB::Text::View view {match};
+      OB::Color color {args.str, type};
 
-      if (view.size() != 1 || view.cols() > 1 ||
-        ! OB::Text::is_graph(OB::Text::to_int32(view.front())))
+      if (! color)
       {
-        return std::make_pair(false, "error: invalid symbol '" + match + "'");
+        return unknown(args.input);
       }
 
-      _ctx.sym.progress_bar = match;
-      _ctx.sym.progress_fill = match;
-    }
-
-    else if (match_opt = OB::String::match(input,
-      std::regex("^sym\\s+progress\\-bar(?:\\s+(.{0,4}))?$")))
-    {
-      auto const match = match_opt.value().at(1);
-
-      if (match.empty())
+      for (auto const member : colors)
       {
-        return std::make_pair(true, "sym progress-bar " +
-          (_ctx.sym.progress_bar == " " ? "clear" : _ctx.sym.progress_bar));
+        _ctx.style.*member = color;
       }
 
-      if (match == "clear")
+      if (name == "primary")
       {
-        _ctx.sym.progress_bar = " ";
-
-        return {};
+        _ctx.style.background = color.bg();
       }
 
-      OB::Text::View view {match};
+      return {};
+    };
+  }
 
-      if (view.size() != 1 || view.cols() > 1 ||
-        ! OB::Text::is_graph(OB::Text::to_int32(view.front())))
+  // toggles, registered with their accessors inlined into each command
+  auto const toggle = [&](std::string const& name, auto const get, auto const set) {
+    cmd["set " + name] = [this, name, get, set](Args const& args) -> Result {
+      if (args.argv.empty())
       {
-        return std::make_pair(false, "error: invalid symbol '" + match + "'");
+        return std::make_pair(true, "set " + name + " " + std::to_string(static_cast<int>(get())));
       }
 
-      _ctx.sym.progress_bar = match;
-    }
+      auto const val = to_bool(args.argv.at(0));
 
-    else if (match_opt = OB::String::match(input,
-      std::regex("^sym\\s+progress\\-fill(?:\\s+(.{0,4}))?$")))
-    {
-      auto const match = match_opt.value().at(1);
-
-      if (match.empty())
+      if (args.argv.size() > 1 || ! val)
       {
-        return std::make_pair(true, "sym progress-fill " +
-          (_ctx.sym.progress_fill == " " ? "clear" : _ctx.sym.progress_fill));
+        return unknown(args.input);
       }
 
-      if (match == "clear")
-      {
-        _ctx.sym.progress_fill = " ";
+      set(val.value());
 
-        return {};
-      }
-
-      OB::Text::View view {match};
+      return {};
+    };
+  };
 
-      if (view.size() != 1 || view.cols() > 1 ||
-        ! OB::Text::is_graph(OB::Text::to_int32(view.front())))
-      {
-        return std::make_pair(false, "error: invalid symbol '" + match + "'");
-      }
+  toggle("view", [this] { return _fltrdr.get_show_line(); }, [this](bool val) { _fltrdr.set_show_line(val); });
+  toggle("perf", [this] { return _ctx.perf.show; }, [this](bool val) { _ctx.perf.show = val; });
+  toggle("incsearch", [this] { return _ctx.incsearch; }, [this](bool val) { _ctx.incsearch = val; });
+  toggle("progress", [this] { return _ctx.show.progress; }, [this](bool val) { _ctx.show.progress = val; });
+  toggle("status", [this] { return _ctx.show.status; }, [this](bool val) { _ctx.show.status = val; });
+  toggle("border", [this] { return _ctx.show.border_top && _ctx.show.border_bottom; },
+    [this](bool val) { _ctx.show.border_top = val; _ctx.show.border_bottom = val; });
+  toggle("border-top", [this] { return _ctx.show.border_top; }, [this](bool val) { _ctx.show.border_top = val; });
+  toggle("border-bottom", [this] { return _ctx.show.border_bottom; }, [this](bool val) { _ctx.show.border_bottom = val; });
 
-      _ctx.sym.progress_fill = match;
-    }
+  // symbols, the first one is shown when queried and all of them are set
+  using Sym = std::string Ctx::Sym::*;
 
-    else if (match_opt = OB::String::match(input,
-      std::regex("^sym\\s+border(?:\\s+(.{0,4}))?$")))
-    {
-      auto const match = match_opt.value().at(1);
+  struct Symbol
+  {
+    char const* name;
+    std::vector<Sym> syms;
+  };
 
-      if (match.empty())
-      {
-        return std::make_pair(true, "sym border " +
-          (_ctx.sym.border_top == " " ? "clear" : _ctx.sym.border_top));
-      }
+  std::vector<Symbol> const symbols {
+    {"progress", {&Ctx::Sym::progress_bar, &Ctx::Sym::progress_fill}},
+    {"progress-bar", {&Ctx::Sym::progress_bar}},
+    {"progress-fill", {&Ctx::Sym::progress_fill}},
+    {"border", {&Ctx::Sym::border_top, &Ctx::Sym::border_top_mark,
+      &Ctx::Sym::border_bottom, &Ctx::Sym::border_bottom_mark}},
+    {"border-top", {&Ctx::Sym::border_top, &Ctx::Sym::border_top_mark}},
+    {"border-top-line", {&Ctx::Sym::border_top}},
+    {"border-top-mark", {&Ctx::Sym::border_top_mark}},
+    {"border-bottom", {&Ctx::Sym::border_bottom, &Ctx::Sym::border_bottom_mark}},
+    {"border-bottom-line", {&Ctx::Sym::border_bottom}},
+    {"border-bottom-mark", {&Ctx::Sym::border_bottom_mark}},
+  };
 
-      if (match == "clear")
+  for (auto const& e : symbols)
+  {
+    cmd["sym "s + e.name] = [this, name = std::string(e.name), syms = e.syms](Args const& args) -> Result {
+      if (args.str.empty())
       {
-        _ctx.sym.border_top = " ";
-        _ctx.sym.border_top_mark = " ";
-        _ctx.sym.border_bottom = " ";
-        _ctx.sym.border_bottom_mark = " ";
+        auto const& val = _ctx.sym.*syms.front();
 
-        return {};
+        return std::make_pair(true, "sym " + name + " " + (val == " " ? "clear" : val));
       }
 
-      OB::Text::View view {match};
+      auto const& val = args.str;
 
-      if (view.size() != 1 || view.cols() > 1 ||
-        ! OB::Text::is_graph(OB::Text::to_int32(view.front())))
+      if (val != "clear" && ! is_sym(val))
       {
-        return std::make_pair(false, "error: invalid symbol '" + match + "'");
+        return std::make_pair(false, "error: invalid symbol '" + val + "'");
       }
 
-      _ctx.sym.border_top = match;
-      _ctx.sym.border_top_mark = match;
-      _ctx.sym.border_bottom = match;
-      _ctx.sym.border_bottom_mark = match;
-    }
-
-    else if (match_opt = OB::String::match(input,
-      std::regex("^sym\\s+border\\-top(?:\\s+(.{0,4}))?$")))
-    {
-      auto const match = match_opt.value().at(1);
-
-      if (match.empty())
+      for (auto const member : syms)
       {
-        return std::make_pair(true, "sym border-top " +
-          (_ctx.sym.border_top == " " ? "clear" : _ctx.sym.border_top));
+        _ctx.sym.*member = val == "clear" ? " " : val;
       }
 
-      if (match == "clear")
-      {
-        _ctx.sym.border_top = " ";
-        _ctx.sym.border_top_mark = " ";
-
-        return {};
-      }
+      return {};
+    };
+  }
+}
 
-      OB::Text::View view {match};
+void Tui::complete_init()
+{
+  auto& words = _complete.words;
 
-      if (view.size() != 1 || view.cols() > 1 ||
-        ! OB::Text::is_graph(OB::Text::to_int32(view.front())))
-      {
-        return std::make_pair(false, "error: invalid symbol '" + match + "'");
-      }
+  // each word of a command name follows the words before it
+  for (auto const& [name, fn] : _commands)
+  {
+    std::istringstream ss {name};
+    std::string ctx;
+    std::string word;
 
-      _ctx.sym.border_top = match;
-      _ctx.sym.border_top_mark = match;
+    while (ss >> word)
+    {
+      words[ctx].emplace_back(word);
+      ctx += (ctx.empty() ? "" : " ") + word;
     }
+  }
 
-    else if (match_opt = OB::String::match(input,
-      std::regex("^sym\\s+border\\-top\\-line(?:\\s+(.{0,4}))?$")))
+  // values of commands that take one of a few
+  for (auto const& [name, fn] : _commands)
+  {
+    if (name.rfind("set ", 0) == 0 || name == "autosave-pause")
+    {
+      words[name] = {"off", "on"};
+    }
+    else if (name.rfind("sym ", 0) == 0 || name == "wpm-avg")
     {
-      auto const match = match_opt.value().at(1);
+      words[name] = {"clear"};
+    }
+  }
 
-      if (match.empty())
-      {
-        return std::make_pair(true, "sym border-top " +
-          (_ctx.sym.border_top == " " ? "clear" : _ctx.sym.border_top));
-      }
+  words["timing"] = {"default", "flat", "freq", "length", "punct"};
+  words["color-depth"] = {"24", "4", "8", "auto"};
 
-      if (match == "clear")
-      {
-        _ctx.sym.border_top = " ";
+  _complete.paths = {"open", "state export", "state import"};
 
-        return {};
-      }
+  for (auto& [ctx, list] : words)
+  {
+    std::sort(list.begin(), list.end());
+    list.erase(std::unique(list.begin(), list.end()), list.end());
+  }
 
-      OB::Text::View view {match};
+  _readline.complete([this](std::string const& str) { return complete(str); });
+}
 
-      if (view.size() != 1 || view.cols() > 1 ||
-        ! OB::Text::is_graph(OB::Text::to_int32(view.front())))
-      {
-        return std::make_pair(false, "error: invalid symbol '" + match + "'");
-      }
+std::vector<std::string> Tui::complete(std::string const& str)
+{
+  std::vector<std::string> res;
 
-      _ctx.sym.border_top = match;
+  // everything after a command taking a path is the path
+  for (auto const& name : _complete.paths)
+  {
+    if (str.size() > name.size() && str.compare(0, name.size(), name) == 0 && str.at(name.size()) == ' ')
+    {
+      return complete_path(str.substr(0, name.size() + 1), str.substr(name.size() + 1));
     }
+  }
+
+  // the last word is completed after the words before it
+  auto const pos = str.rfind(' ');
+  auto const word = pos == std::string::npos ? str : str.substr(pos + 1);
 
-    else if (match_opt = OB::String::match(input,
-      std::regex("^sym\\s+border\\-top\\-mark(?:\\s+(.{0,4}))?$")))
+  std::string ctx;
+  {
+    std::istringstream ss {pos == std::string::npos ? std::string() : str.substr(0, pos)};
+    std::string val;
+
+    while (ss >> val)
     {
-      auto const match = match_opt.value().at(1);
+      ctx += (ctx.empty() ? "" : " ") + val;
+    }
+  }
 
-      if (match.empty())
-      {
-        return std::make_pair(true, "sym border-top-mark " +
-          (_ctx.sym.border_top_mark == " " ? "clear" : _ctx.sym.border_top_mark));
-      }
+  auto const list = _complete.words.find(ctx);
 
-      if (match == "clear")
-      {
-        _ctx.sym.border_top_mark = " ";
+  if (list == _complete.words.end())
+  {
+    return res;
+  }
 
-        return {};
-      }
+  auto const head = str.substr(0, str.size() - word.size());
 
-      OB::Text::View view {match};
+  for (auto it = std::lower_bound(list->second.begin(), list->second.end(), word);
+    it != list->second.end() && it->compare(0, word.size(), word) == 0; ++it)
+  {
+    // a word that something follows is completed with a space
+    auto const next = ctx.empty() ? *it : ctx + " " + *it;
+    bool const more {_complete.words.count(next) ||
+      std::find(_complete.paths.begin(), _complete.paths.end(), next) != _complete.paths.end()};
 
-      if (view.size() != 1 || view.cols() > 1 ||
-        ! OB::Text::is_graph(OB::Text::to_int32(view.front())))
-      {
-        return std::make_pair(false, "error: invalid symbol '" + match + "'");
-      }
+    res.emplace_back(head + *it + (more ? " " : ""));
+  }
 
-      _ctx.sym.border_top_mark = match;
-    }
+  return res;
+}
 
-    else if (match_opt = OB::String::match(input,
-      std::regex("^sym\\s+border\\-bottom(?:\\s+(.{0,4}))?$")))
-    {
-      auto const match = match_opt.value().at(1);
+std::vector<std::string> Tui::complete_path(std::string const& prefix, std::string const& str)
+{
+  std::vector<std::string> res;
 
-      if (match.empty())
-      {
-        return std::make_pair(true, "sym border-bottom " +
-          (_ctx.sym.border_bottom == " " ? "clear" : _ctx.sym.border_bottom));
-      }
+  auto const slash = str.rfind('/');
+  auto const dir = slash == std::string::npos ? std::string() : str.substr(0, slash + 1);
+  auto const base = slash == std::string::npos ? str : str.substr(slash + 1);
+  fs::path const path {dir.empty() ? fs::path(".") : fs::path(dir)};
 
-      if (match == "clear")
-      {
-        _ctx.sym.border_bottom = " ";
-        _ctx.sym.border_bottom_mark = " ";
+  std::error_code ec;
+  auto const time = fs::last_write_time(path, ec);
 
-        return {};
-      }
+  if (ec)
+  {
+    return res;
+  }
 
-      OB::Text::View view {match};
+  auto& cached = _complete.dirs[path.string()];
 
-      if (view.size() != 1 || view.cols() > 1 ||
-        ! OB::Text::is_graph(OB::Text::to_int32(view.front())))
-      {
-        return std::make_pair(false, "error: invalid symbol '" + match + "'");
-      }
+  if (cached.entries.empty() || cached.time != time)
+  {
+    cached.time = time;
+    cached.entries.clear();
 
-      _ctx.sym.border_bottom = match;
-      _ctx.sym.border_bottom_mark = match;
+    for (auto const& entry : fs::directory_iterator(path, ec))
+    {
+      cached.entries.emplace_back(entry.path().filename().string() + (entry.is_directory(ec) ? "/" : ""));
     }
 
-    else if (match_opt = OB::String::match(input,
-      std::regex("^sym\\s+border\\-bottom\\-line(?:\\s+(.{0,4}))?$")))
+    std::sort(cached.entries.begin(), cached.entries.end());
+  }
+
+  for (auto it = std::lower_bound(cached.entries.begin(), cached.entries.end(), base);
+    it != cached.entries.end() && it->compare(0, base.size(), base) == 0; ++it)
+  {
+    // hidden entries only when asked for
+    if (base.empty() && it->front() == '.')
     {
-      auto const match = match_opt.value().at(1);
+      continue;
+    }
 
-      if (match.empty())
-      {
-        return std::make_pair(true, "sym border-bottom-line " +
-          (_ctx.sym.border_bottom == " " ? "clear" : _ctx.sym.border_bottom));
-      }
+    res.emplace_back(prefix + dir + *it);
+  }
 
-      if (match == "clear")
-      {
-        _ctx.sym.border_bottom = " ";
+  return res;
+}
 
-        return {};
-      }
+std::string Tui::prompt(OB::Readline& readline, std::string const& str,
+  std::function<void(OB::Readline&, std::string const&)> const& changed)
+{
+  // clear prompt message
+  _ctx.prompt.expire = {};
 
-      OB::Text::View view {match};
+  // set prompt style
+  readline.style(_ctx.style.secondary.value() + _ctx.style.bg.value());
+  readline.prompt(str, _ctx.style.prompt.value() + _ctx.style.bg.value());
 
-      if (view.size() != 1 || view.cols() > 1 ||
-        ! OB::Text::is_graph(OB::Text::to_int32(view.front())))
-      {
-        return std::make_pair(false, "error: invalid symbol '" + match + "'");
-      }
+  // the prompt writes to the terminal directly
+  drain();
 
-      _ctx.sym.border_bottom = match;
-    }
+  std::cout
+  << aec::cursor_save
+  << aec::cursor_set(0, _ctx.height)
+  << aec::erase_line
+  << aec::cursor_show
+  << std::flush;
 
-    else if (match_opt = OB::String::match(input,
-      std::regex("^sym\\s+border\\-bottom\\-mark(?:\\s+(.{0,4}))?$")))
-    {
-      auto const match = match_opt.value().at(1);
+  readline.begin();
 
-      if (match.empty())
-      {
-        return std::make_pair(true, "sym border-bottom-mark " +
-          (_ctx.sym.border_bottom_mark == " " ? "clear" : _ctx.sym.border_bottom_mark));
-      }
+  // read user input, handling each key as soon as it arrives
+  std::string utf8;
+  std::string last;
 
-      if (match == "clear")
+  while (_ctx.is_running)
+  {
+    if (! OB::Term::wait_input())
+    {
+      if (OB::Term::input_closed())
       {
-        _ctx.sym.border_bottom_mark = " ";
+        _ctx.is_running = false;
 
-        return {};
+        break;
       }
 
-      OB::Text::View view {match};
-
-      if (view.size() != 1 || view.cols() > 1 ||
-        ! OB::Text::is_graph(OB::Text::to_int32(view.front())))
+      if (OB::Term::Winch::changed())
       {
-        return std::make_pair(false, "error: invalid symbol '" + match + "'");
+        _ctx.relayout = true;
+        readline.redraw();
       }
 
-      _ctx.sym.border_bottom_mark = match;
+      continue;
     }
 
-    else
+    char32_t key {0};
+    bool open {true};
+
+    // keys after the end of the line are left for the reader
+    while (open && (key = OB::Term::get_key(&utf8)) > 0)
     {
-      return std::make_pair(false, "warning: unknown command '" + input + "'");
+      open = readline.feed(key, utf8);
     }
-  }
-
-  // unknown
-  else
-  {
-    return std::make_pair(false, "warning: unknown command '" + input + "'");
-  }
-
-  return {};
-}
 
-void Tui::command_prompt()
-{
-  // reset prompt message count
-  _ctx.prompt.count = 0;
-
-  // set prompt style
-  _readline.style(_ctx.style.secondary.value() + _ctx.style.bg.value());
-  _readline.prompt(":", _ctx.style.prompt.value() + _ctx.style.bg.value());
+    if (! open)
+    {
+      break;
+    }
 
-  std::cout
-  << aec::cursor_save
-  << aec::cursor_set(0, _ctx.height)
-  << aec::erase_line
-  << aec::cursor_show
-  << std::flush;
+    // once per batch of keys, a paste is handled as a whole
+    if (changed && readline.str() != last)
+    {
+      last = readline.str();
+      changed(readline, last);
+    }
+  }
 
-  // read user input
-  auto input = _readline(_ctx.is_running);
+  auto input = readline.end();
 
   std::cout
   << aec::cursor_hide
   << aec::cursor_load
   << std::flush;
 
+  return input;
+}
+
+void Tui::command_prompt()
+{
+  auto input = prompt(_readline, ":");
+
   if (auto const res = command(input))
   {
     set_status(res.value().first, res.value().second);
@@ -2251,71 +3105,50 @@ void Tui::command_prompt()
 
 void Tui::search_forward()
 {
-  // reset prompt message count
-  _ctx.prompt.count = 0;
-
-  // set prompt style
-  _readline_search.style(_ctx.style.secondary.value() + _ctx.style.bg.value());
-  _readline_search.prompt("/", _ctx.style.prompt.value() + _ctx.style.bg.value());
-
-  std::cout
-  << aec::cursor_save
-  << aec::cursor_set(0, _ctx.height)
-  << aec::erase_line
-  << aec::cursor_show
-  << std::flush;
-
-  // read user input
-  auto input {_readline_search(_ctx.is_running)};
+  search_prompt(true);
+}
 
-  std::cout
-  << aec::cursor_hide
-  << aec::cursor_load
-  << std::flush;
+void Tui::search_backward()
+{
+  search_prompt(false);
+}
 
-  if (! _ctx.is_running)
-  {
-    _ctx.is_running = false;
+void Tui::search_prompt(bool const forward)
+{
+  std::function<void(OB::Readline&, std::string const&)> preview;
 
-    return;
-  }
-  else if (! input.empty() && ! _fltrdr.search(input, true))
+  if (_ctx.incsearch)
   {
-    set_status(false, input);
-  }
-}
+    _fltrdr.search_begin(forward);
 
-void Tui::search_backward()
-{
-  // reset prompt message count
-  _ctx.prompt.count = 0;
+    preview = [&](OB::Readline& readline, std::string const& str) {
+      // stop scanning as soon as another key arrives, it starts a new preview
+      auto const stop = [] { return OB::Term::input_ready(); };
 
-  // set prompt style
-  _readline_search.style(_ctx.style.secondary.value() + _ctx.style.bg.value());
-  _readline_search.prompt("?", _ctx.style.prompt.value() + _ctx.style.bg.value());
+      if (_fltrdr.search_preview(str, stop) == OB::Text::Regex::Find::stopped)
+      {
+        return;
+      }
 
-  std::cout
-  << aec::cursor_save
-  << aec::cursor_set(0, _ctx.height)
-  << aec::erase_line
-  << aec::cursor_show
-  << std::flush;
+      render();
+      drain();
+      readline.redraw();
+    };
+  }
 
-  // read user input
-  auto input {_readline_search(_ctx.is_running)};
+  auto input = prompt(_readline_search, forward ? "/" : "?", preview);
 
-  std::cout
-  << aec::cursor_hide
-  << aec::cursor_load
-  << std::flush;
+  // the search itself runs from where the preview started
+  if (_ctx.incsearch)
+  {
+    _fltrdr.search_cancel();
+  }
 
   if (! _ctx.is_running)
   {
-    _ctx.is_running = false;
-
     return;
   }
-  else if (! input.empty() && ! _fltrdr.search(input, false))
+  else if (! input.empty() && ! _fltrdr.search(input, forward))
   {
     set_status(false, input);
   }
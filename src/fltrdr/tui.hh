@@ -2,12 +2,16 @@
 #define TUI_HH
 
 #include "fltrdr/fltrdr.hh"
+#include "fltrdr/state.hh"
+#include "fltrdr/store.hh"
 
 #include "ob/color.hh"
+#include "ob/mailbox.hh"
 #include "ob/readline.hh"
 #include "ob/string.hh"
 #include "ob/text.hh"
 #include "ob/term.hh"
+#include "ob/vterm.hh"
 namespace aec = OB::Term::ANSI_Escape_Codes;
 
 #include <cstdio>
@@ -18,8 +22,16 @@ namespace aec = OB::Term::ANSI_Escape_Codes;
 #include <string>
 #include <vector>
 #include <sstream>
+#include <fstream>
+#include <chrono>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
 #include <utility>
 #include <optional>
+#include <functional>
+#include <unordered_map>
 
 #include <filesystem>
 namespace fs = std::filesystem;
@@ -30,28 +42,120 @@ public:
 
   Tui();
 
+  // headless, frames are rendered into the virtual terminal
+  explicit Tui(OB::VTerm& vterm);
+
+  ~Tui();
+
   Tui& init(fs::path const& path = {});
   void base_config(fs::path const& path);
   void load_config(fs::path const& path);
   bool save_state();
   bool load_state();
+  bool import_state(fs::path const& path);
+  bool export_state(fs::path const& path);
   void load_hist_command(fs::path const& path);
   void load_hist_search(fs::path const& path);
+  void perf_log(fs::path const& path);
   void run();
 
+  // headless play mode, render a frame of the current word and advance
+  // returns the scheduled display time of the word,
+  // or 0 after the last word
+  std::chrono::microseconds step();
+
+  std::optional<std::pair<bool, std::string>> command(std::string const& input);
+
 private:
 
-  void get_input(int& wait);
+  using Clock = std::chrono::steady_clock;
+
+  using Result = std::optional<std::pair<bool, std::string>>;
+
+  // arguments of a command
+  struct Args
+  {
+    // the whole command line
+    std::string input;
+
+    // words after the command name
+    std::vector<std::string> argv;
+
+    // text after the command name as typed
+    std::string str;
+  };
+
+  // command name to handler, sub commands are stored as 'name sub'
+  std::unordered_map<std::string, std::function<Result(Args const& args)>> _commands;
+
+  void commands_init();
+
+  // tab completion of command names, their values and paths,
+  // word lists are sorted once so a lookup is a binary search
+  struct Complete
+  {
+    // words that may follow the words typed so far, '' for the first word
+    std::unordered_map<std::string, std::vector<std::string>> words;
+
+    // commands whose argument is a path
+    std::vector<std::string> paths;
+
+    // sorted entries of each directory listed, listed again once it changes
+    struct Dir
+    {
+      fs::file_time_type time;
+      std::vector<std::string> entries;
+    };
+
+    std::unordered_map<std::string, Dir> dirs;
+  } _complete;
+
+  void complete_init();
+  std::vector<std::string> complete(std::string const& str);
+  std::vector<std::string> complete_path(std::string const& prefix, std::string const& str);
+
+  State get_state();
+  void set_state(State const& state);
+
+  static std::pair<bool, std::string> unknown(std::string const& input);
+  static bool is_uint(std::string const& str, std::size_t const digits);
+  static std::optional<bool> to_bool(std::string const& str);
+  static bool is_sym(std::string const& str);
+
+  void get_input(std::chrono::microseconds& wait);
   bool press_to_continue(std::string const& str = "ANY KEY", char32_t val = 0);
 
-  std::optional<std::pair<bool, std::string>> command(std::string const& input);
+  std::string prompt(OB::Readline& readline, std::string const& str,
+    std::function<void(OB::Readline&, std::string const&)> const& changed = {});
+  void search_prompt(bool const forward);
   void command_prompt();
 
   void event_loop();
+  void layout();
   int screen_size();
 
+  void render();
   void clear();
   void refresh();
+  void perf_record(std::size_t const bytes);
+
+  void writer_start();
+  void writer_stop();
+  void writer_loop();
+  bool writer_behind();
+  void drain();
+
+  std::pair<double, double> calibrate();
+
+  void autosave_start();
+  void autosave_stop();
+  void autosave_loop();
+  void autosave(bool const force = false);
+  bool autosave_enabled();
+
+  bool recover_state();
+  std::string state_key();
+  bool write_state(std::string const& key, State const& state);
 
   void draw();
   void draw_content();
@@ -61,18 +165,96 @@ private:
   void draw_status();
   void draw_prompt_message();
   void draw_keybuf();
+  void draw_perf();
 
   void play();
   void pause();
 
   void set_wait();
   void set_status(bool success, std::string const& msg);
+  void set_color_depth(std::string const& val);
 
   void search_forward();
   void search_backward();
 
-  OB::Term::Mode _term_mode;
-  bool const _colorterm;
+  std::optional<OB::Term::Mode> _term_mode;
+  std::optional<OB::Term::Winch> _winch;
+
+  // virtual terminal used instead of stdout in headless mode
+  OB::VTerm* _vterm {nullptr};
+
+  // terminal output thread, so a slow terminal drops frames
+  // instead of holding up input and playback
+  struct Writer
+  {
+    struct Frame
+    {
+      std::string str;
+      std::size_t id {0};
+    };
+
+    // latest frame wins, an unwritten frame is replaced by a newer one
+    OB::Mailbox<Frame> frames;
+
+    // only used to sleep and wake, frames are passed lock-free
+    std::mutex mutex;
+    std::condition_variable cv;
+    bool stop {false};
+
+    // id of the last frame pushed and the last frame written
+    std::size_t pushed {0};
+    std::atomic<std::size_t> written {0};
+
+    // duration of the last write and its moving average
+    std::atomic<Clock::rep> write {0};
+    std::atomic<Clock::rep> write_avg {0};
+
+    // declared last, it uses the members above
+    std::thread thread;
+  } _writer;
+
+  // periodic state checkpoints, written on a background thread
+  // so the frame loop never waits on the disk
+  struct Autosave
+  {
+    // latest checkpoint wins, an unwritten one is replaced by a newer one
+    std::mutex mutex;
+    std::condition_variable cv;
+    bool stop {false};
+    std::optional<std::pair<std::string, State>> pending;
+
+    // held while writing a state file, by the thread and by explicit saves
+    std::mutex io;
+
+    // key and record of the last state written, without its timestamp,
+    // an identical state is not written again
+    std::string last;
+
+    // checkpoint every interval, every number of words, and on pause,
+    // 0 disables the interval and word count
+    std::chrono::seconds interval {60};
+    std::size_t words {0};
+    bool pause {true};
+
+    // time of the next interval checkpoint and word index of the last one
+    Clock::time_point next {};
+    std::size_t index {0};
+
+    // declared last, it uses the members above
+    std::thread thread;
+  } _autosave;
+
+  // reading state of every document, keyed by content id
+  Store _store;
+
+  // states kept when trimming the store on exit,
+  // the most recent count, and those saved within age, 0 disables a limit
+  struct Retain
+  {
+    std::size_t count {1000};
+    std::chrono::seconds age {0};
+  } _retain;
+
   OB::Readline _readline;
   OB::Readline _readline_search;
   Fltrdr _fltrdr;
@@ -95,17 +277,23 @@ private:
     std::size_t width {0};
     std::size_t height {0};
 
+    // screen size needs to be read and the layout recomputed
+    bool relayout {true};
+
     // minimum terminal size
     std::size_t width_min {20};
     std::size_t height_min {6};
 
-    // output buffer
-    std::ostringstream buf;
+    // output buffer, read out into a string that keeps its capacity
+    std::stringstream buf;
+
+    // serialised frame when there is no writer thread
+    std::string frame;
 
     // control when to exit the event loop
     bool is_running {true};
 
-    // interval between reading a keypress
+    // interval between checking the screen size while it is too small
     int const input_interval {50};
 
     // horizontal offset from center
@@ -120,8 +308,15 @@ private:
       int count_down {0};
       bool counting_down {false};
 
-      int wait {250};
-      int refresh_rate {250};
+      // display time of the current frame
+      std::chrono::microseconds wait {std::chrono::milliseconds(250)};
+      std::chrono::microseconds const refresh_rate {std::chrono::milliseconds(250)};
+
+      // absolute time the current word is shown until
+      Clock::time_point deadline {};
+
+      // step rendered the last word
+      bool step_end {false};
     } state;
 
     // status
@@ -135,12 +330,50 @@ private:
     OB::Text::Char32 key;
     std::vector<OB::Text::Char32> keys;
 
+    // per-frame timing instrumentation
+    struct Perf
+    {
+      // show the overlay on the top line
+      bool show {false};
+
+      // line-oriented log, one frame per line
+      std::ofstream log;
+
+      // frames rendered
+      std::size_t frame {0};
+
+      // start of the session, used as the log time base
+      Clock::time_point begin {Clock::now()};
+
+      // time spent in each stage of the last frame
+      Clock::duration set_line {};
+      Clock::duration draw {};
+      Clock::duration serialise {};
+      Clock::duration write {};
+
+      // bytes written for the last frame
+      std::size_t bytes {0};
+
+      // frames skipped or replaced before the terminal took them
+      std::size_t dropped {0};
+
+      // the frame of the current word was skipped and is not drawn yet
+      bool skipped {false};
+
+      // scheduled and measured display time of the last word
+      Clock::duration scheduled {};
+      Clock::duration actual {};
+      Clock::time_point word {};
+    } perf;
+
     // command prompt
     struct Prompt
     {
       std::string str;
-      int count {0};
-      int timeout {12};
+
+      // time the message is shown until
+      Clock::time_point expire {};
+      std::chrono::milliseconds const timeout {3000};
     } prompt;
 
     struct Show
@@ -151,6 +384,12 @@ private:
       bool status {true};
     } show;
 
+    // preview the match while a search pattern is typed
+    bool incsearch {true};
+
+    // output colour depth, 'auto' detects it from the environment
+    std::string color_depth {"auto"};
+
     struct Style
     {
       OB::Color bg {OB::Color::Type::bg};
@@ -26,7 +26,7 @@ int program_options(Parg& pg)
   pg.name("fltrdr").version("0.3.1 (09.05.2019)");
   pg.description("A TUI text reader for the terminal.");
 
-  pg.usage("[--config-base <dir>] [--config|-u <file>] [<file>]");
+  pg.usage("[--config-base <dir>] [--config|-u <file>] [--perf-log <file>] [<file>]");
   pg.usage("[--help|-h]");
   pg.usage("[--version|-v]");
   pg.usage("[--license]");
@@ -44,6 +44,7 @@ int program_options(Parg& pg)
     "<ctrl-u>\n    clear the prompt",
     "<up>|<ctrl-p>\n    previous history value based on current input",
     "<down>|<ctrl-n>\n    next history value based on current input",
+    "<tab>\n    complete the command, value, path or history value, repeat to cycle through the matches",
     "<left>|<ctrl-b>\n    move cursor left",
     "<right>|<ctrl-f>\n    move cursor right",
     "<home>|<ctrl-a>\n    move cursor to the start of the input",
@@ -85,12 +86,30 @@ int program_options(Parg& pg)
     "q|quit|Quit|exit\n    quit the program",
     "w\n    save state",
     "wq\n    save state and quit the program",
+    "autosave <seconds>\n    save the state in the background at most this often while it changes,\n    default is 60, '0' turns it off",
+    "autosave-words <value>\n    save the state in the background after moving this many words,\n    default is '0', which turns it off",
+    "autosave-pause <on|off>\n    save the state in the background on pause, default is 'on'",
+    "state export <file>\n    write the current state to 'file' as a list of commands",
+    "state import <file>\n    run the commands in a state file written by 'state export'",
+    "state list\n    show the number of saved states and the size of the state store",
+    "state gc\n    remove the states past 'state-keep' and 'state-age' and compact the state store",
+    "state-keep <value>\n    number of most recently saved states kept, default is 1000, '0' keeps all",
+    "state-age <days>\n    remove states not saved within this many days, default is '0', which keeps all",
+    "history-size <value>\n    number of entries kept in the command and search history,\n    default is 10000, '0' keeps all, the history files are compacted on exit",
     "open <path>\n    open file for reading",
-    "wpm <60-1200>\n    set wpm value",
+    "wpm <value>\n    set wpm value, limited to the range set by 'wpm-min' and 'wpm-max'",
+    "wpm-min <value>\n    set the lowest wpm value, default is 60",
+    "wpm-max <value>\n    set the highest wpm value, default is 1200,\n    set before 'wpm' in a config file to allow higher values",
+    "wpm-step <value>\n    set how much 'j' and 'k' change the wpm value by, default is 10",
+    "calibrate\n    measure the frame rate the terminal sustains with the current settings,\n    and report the highest wpm it can show without dropping frames",
+    "timing <default|flat|length|punct|freq>\n    set how long each word is shown for relative to the wpm value,\n    'flat' shows every word for the same time, 'length' longer words for longer,\n    'punct' pauses on punctuation, 'freq' shows words rare in the text for longer,\n    'default' combines 'length' and 'punct'",
     "goto <\\d+>\n    goto specified word index",
     "prev <0-60>\n    set number of previous words to show",
     "next <0-60>\n    set number of next words to show",
+    "chunk <1-20>\n    set number of words to show at once,\n    the wpm value still counts single words",
+    "chunk-cols <0-200>\n    show as many words at once as fit in the given display columns,\n    '0' uses the word count set by 'chunk'",
     "offset <0-6>\n    set offset of focus point from center",
+    "color-depth <auto|24|8|4>\n    set the output colour depth in bits, 'auto' detects it from 'COLORTERM' and 'TERM'",
 
     R"RAW(
   timer <value>
@@ -119,7 +138,11 @@ int program_options(Parg& pg)
     border-top
       toggle border top visibility
     border-bottom
-      toggle border bottom visibility)RAW",
+      toggle border bottom visibility
+    perf
+      toggle frame timing overlay visibility
+    incsearch
+      toggle moving to the match while a search is typed)RAW",
 
     R"RAW(
   sym <value> <char|clear>
@@ -203,7 +226,7 @@ int program_options(Parg& pg)
   State Directory: 'BASE/state'
   History Directory: 'BASE/history'
   Config File: 'BASE/config'
-  State Files: 'BASE/state/<content-id>'
+  State Store: 'BASE/state/store', one log of the state of every file, see 'state export'
   Search History File: 'BASE/history/search'
   Command History File: 'BASE/history/command'
 
@@ -224,6 +247,7 @@ int program_options(Parg& pg)
     "cat <file> | fltrdr",
     "fltrdr --config \"./path/to/config/file\"",
     "fltrdr --config-base \"~/.config/fltrdr\"",
+    "fltrdr --perf-log \"./perf.log\" <file>",
     "fltrdr --help",
     "fltrdr --version",
     "fltrdr --license",
@@ -249,6 +273,7 @@ int program_options(Parg& pg)
   // options
   pg.set("config,u", "", "file", "Use the commands in the config file 'file' for initialization.\n    All other initializations are skipped. To skip all initializations,\n    use the special name 'NONE'.");
   pg.set("config-base", "", "dir", "use 'dir' as the base config directory.\n    To skip all initializations,\n    use the special name 'NONE'.");
+  pg.set("perf-log", "", "file", "Write per-frame render timings to 'file', one frame per line.");
 
   pg.set_pos();
 
@@ -357,6 +382,11 @@ int main(int argc, char *argv[])
       tui.init();
     }
 
+    if (pg.find("perf-log"))
+    {
+      tui.perf_log(pg.get<fs::path>("perf-log"));
+    }
+
     // load files
     {
       // determine base config directory
@@ -368,9 +398,6 @@ int main(int argc, char *argv[])
       if (base_config_dir != "NONE" &&
         fs::exists(base_config_dir) && fs::is_directory(base_config_dir))
       {
-        // set base config directory
-        tui.base_config(base_config_dir);
-
         // check/create default directories
 
         fs::path state_dir {base_config_dir / fs::path("state")};
@@ -387,14 +414,17 @@ int main(int argc, char *argv[])
           fs::create_directory(history_dir);
         }
 
-        // load history files
-        tui.load_hist_command(history_dir / fs::path("command"));
-        tui.load_hist_search(history_dir / fs::path("search"));
+        // set base config directory, opens the state store
+        tui.base_config(base_config_dir);
 
-        // load config file
+        // load config file, before the history files so their size limit applies
         tui.load_config(pg.find("config") ? pg.get<fs::path>("config") :
           base_config_dir / fs::path("config"));
 
+        // load history files
+        tui.load_hist_command(history_dir / fs::path("command"));
+        tui.load_hist_search(history_dir / fs::path("search"));
+
         // load content state if available
         tui.load_state();
       }
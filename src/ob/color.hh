@@ -5,7 +5,11 @@
 #include "ob/term.hh"
 namespace aec = OB::Term::ANSI_Escape_Codes;
 
+#include <cctype>
+
+#include <array>
 #include <string>
+#include <algorithm>
 #include <unordered_map>
 
 namespace OB
@@ -51,6 +55,9 @@ class Color
     {"white bright", "\x1b[107m"},
   };
 
+  // output colour depth used when resolving a key to its escape sequence
+  inline static Term::Depth::value _depth {Term::Depth::bit24};
+
 public:
 
   struct Type
@@ -82,6 +89,16 @@ public:
   Color& operator=(Color&& rhs) = default;
   Color& operator=(Color const&) = default;
 
+  static Term::Depth::value depth()
+  {
+    return _depth;
+  }
+
+  static void depth(Term::Depth::value const val)
+  {
+    _depth = val;
+  }
+
   Color& operator=(std::string const& k)
   {
     clear();
@@ -148,6 +165,17 @@ public:
     return *this;
   }
 
+  // resolve the key again, e.g. after the output colour depth changed
+  Color& update()
+  {
+    if (_valid)
+    {
+      key(_key);
+    }
+
+    return *this;
+  }
+
   bool is_fg() const
   {
     return _fg;
@@ -184,34 +212,21 @@ public:
       else
       {
         // 21-bit color
-        if (k.at(0) == '#' && OB::String::assert_rx(k,
-          std::regex("^#[0-9a-fA-F]{3}(?:[0-9a-fA-F]{3})?$")))
+        if (k.at(0) == '#' && (k.size() == 4 || k.size() == 7) &&
+          std::all_of(k.begin() + 1, k.end(), [](auto const c) { return std::isxdigit(static_cast<unsigned char>(c)); }))
         {
           _key = k;
-          if (_fg)
-          {
-            _value = aec::fg_true(k);
-          }
-          else
-          {
-            _value = aec::bg_true(k);
-          }
+          _value = sgr_rgb(hex_to_rgb(k));
           _valid = true;
         }
 
         // 8-bit color
-        else if (OB::String::assert_rx(k, std::regex("^[0-9]{1,3}$")) &&
+        else if (k.size() <= 3 &&
+          std::all_of(k.begin(), k.end(), [](auto const c) { return c >= '0' && c <= '9'; }) &&
           std::stoi(k) >= 0 && std::stoi(k) <= 255)
         {
           _key = k;
-          if (_fg)
-          {
-            _value = aec::fg_256(k);
-          }
-          else
-          {
-            _value = aec::bg_256(k);
-          }
+          _value = sgr_index(std::stoi(k));
           _valid = true;
         }
 
@@ -242,6 +257,159 @@ public:
 
 private:
 
+  struct Rgb
+  {
+    int r {0};
+    int g {0};
+    int b {0};
+  };
+
+  static Rgb hex_to_rgb(std::string const& k)
+  {
+    auto hex = k.substr(1);
+
+    if (hex.size() == 3)
+    {
+      hex = {hex[0], hex[0], hex[1], hex[1], hex[2], hex[2]};
+    }
+
+    return {
+      std::stoi(hex.substr(0, 2), nullptr, 16),
+      std::stoi(hex.substr(2, 2), nullptr, 16),
+      std::stoi(hex.substr(4, 2), nullptr, 16)
+    };
+  }
+
+  // default xterm palette value of a 256 colour index
+  static Rgb palette(int const n)
+  {
+    static std::array<Rgb, 16> constexpr ansi {{
+      {0, 0, 0}, {205, 0, 0}, {0, 205, 0}, {205, 205, 0},
+      {0, 0, 238}, {205, 0, 205}, {0, 205, 205}, {229, 229, 229},
+      {127, 127, 127}, {255, 0, 0}, {0, 255, 0}, {255, 255, 0},
+      {92, 92, 255}, {255, 0, 255}, {0, 255, 255}, {255, 255, 255}
+    }};
+
+    static std::array<int, 6> constexpr cube {{0, 95, 135, 175, 215, 255}};
+
+    if (n < 16)
+    {
+      return ansi.at(static_cast<std::size_t>(n));
+    }
+
+    if (n < 232)
+    {
+      auto const i = n - 16;
+
+      return {
+        cube.at(static_cast<std::size_t>(i / 36)),
+        cube.at(static_cast<std::size_t>((i / 6) % 6)),
+        cube.at(static_cast<std::size_t>(i % 6))
+      };
+    }
+
+    auto const v = 8 + (n - 232) * 10;
+
+    return {v, v, v};
+  }
+
+  static int distance(Rgb const& lhs, Rgb const& rhs)
+  {
+    auto const r = lhs.r - rhs.r;
+    auto const g = lhs.g - rhs.g;
+    auto const b = lhs.b - rhs.b;
+
+    return r * r + g * g + b * b;
+  }
+
+  // closest colour in the 16 colour palette
+  static int nearest_16(Rgb const& c)
+  {
+    int res {0};
+    int min {distance(c, palette(0))};
+
+    for (int i = 1; i < 16; ++i)
+    {
+      if (auto const d = distance(c, palette(i)); d < min)
+      {
+        min = d;
+        res = i;
+      }
+    }
+
+    return res;
+  }
+
+  // closest colour in the 6x6x6 cube or the greyscale ramp
+  static int nearest_256(Rgb const& c)
+  {
+    auto const level = [](int const v) {
+      return v < 48 ? 0 : v < 115 ? 1 : (v - 35) / 40;
+    };
+
+    int const cube {16 + 36 * level(c.r) + 6 * level(c.g) + level(c.b)};
+
+    int const avg {(c.r + c.g + c.b) / 3};
+    int const grey {avg > 238 ? 255 : 232 + (avg - 3) / 10};
+
+    return distance(c, palette(cube)) <= distance(c, palette(grey)) ? cube : grey;
+  }
+
+  // shortest sequence for a colour of the 16 colour palette
+  std::string sgr_16(int const n) const
+  {
+    auto const base = (_fg ? 30 : 40) + (n < 8 ? n : 60 + n - 8);
+
+    return aec::esc + "[" + std::to_string(base) + "m";
+  }
+
+  std::string sgr_index(int const n) const
+  {
+    if (n < 16)
+    {
+      return sgr_16(n);
+    }
+
+    if (_depth == Term::Depth::bit4)
+    {
+      return sgr_16(nearest_16(palette(n)));
+    }
+
+    return aec::esc + (_fg ? "[38;5;" : "[48;5;") + std::to_string(n) + "m";
+  }
+
+  std::string sgr_rgb(Rgb const& c) const
+  {
+    switch (_depth)
+    {
+      case Term::Depth::bit4:
+      {
+        return sgr_16(nearest_16(c));
+      }
+
+      case Term::Depth::bit8:
+      {
+        return sgr_index(nearest_256(c));
+      }
+
+      default:
+      {
+        // an exact palette match is shorter than the 24-bit form
+        auto const n = nearest_256(c);
+
+        if (distance(c, palette(n)) == 0)
+        {
+          return sgr_index(n);
+        }
+
+        return aec::esc + (_fg ? "[38;2;" : "[48;2;") +
+          std::to_string(c.r) + ";" +
+          std::to_string(c.g) + ";" +
+          std::to_string(c.b) + "m";
+      }
+    }
+  }
+
   bool _valid {false};
   bool _fg {true};
   std::string _key {"clear"};
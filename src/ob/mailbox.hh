@@ -0,0 +1,88 @@
+#ifndef OB_MAILBOX_HH
+#define OB_MAILBOX_HH
+
+#include <cstddef>
+
+#include <array>
+#include <atomic>
+
+namespace OB
+{
+
+// lock-free single producer single consumer slot, latest value wins
+// triple buffered, the producer fills the back buffer and swaps it with
+// the middle one, the consumer swaps the middle one with its front buffer,
+// neither side ever waits on the other
+template<typename T>
+class Mailbox
+{
+public:
+
+  Mailbox() = default;
+
+  Mailbox(Mailbox const&) = delete;
+  Mailbox& operator=(Mailbox const&) = delete;
+
+  // producer, buffer to fill before calling push
+  T& back()
+  {
+    return _buf[_back];
+  }
+
+  // producer, publish the back buffer
+  // returns true if it replaced a value the consumer never took
+  bool push()
+  {
+    auto const prev = _mid.exchange(_back | fresh, std::memory_order_acq_rel);
+    _back = prev & index;
+
+    return prev & fresh;
+  }
+
+  // consumer, true if a value is waiting to be taken
+  bool ready() const
+  {
+    return _mid.load(std::memory_order_acquire) & fresh;
+  }
+
+  // consumer, take the latest value into the front buffer
+  // returns false if there was nothing new
+  bool pull()
+  {
+    if (! ready())
+    {
+      return false;
+    }
+
+    auto const prev = _mid.exchange(_front, std::memory_order_acq_rel);
+    _front = prev & index;
+
+    return true;
+  }
+
+  // consumer, the last value taken
+  T& front()
+  {
+    return _buf[_front];
+  }
+
+private:
+
+  static unsigned constexpr index {0x3};
+  static unsigned constexpr fresh {0x4};
+
+  std::array<T, 3> _buf {};
+
+  // producer owned
+  unsigned _back {0};
+
+  // shared, buffer index and whether it holds an unread value
+  std::atomic<unsigned> _mid {1};
+
+  // consumer owned
+  unsigned _front {2};
+}; // class Mailbox
+
+} // namespace OB
+
+#endif // OB_MAILBOX_HH
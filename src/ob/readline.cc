@@ -5,14 +5,18 @@
 #include "ob/term.hh"
 namespace aec = OB::Term::ANSI_Escape_Codes;
 
+#include <unicode/utf8.h>
+
 #include <cstdio>
 #include <cstddef>
 #include <cstdint>
 #include <cstdlib>
 
-#include <deque>
+#include <list>
 #include <string>
+#include <string_view>
 #include <vector>
+#include <unordered_map>
 #include <fstream>
 #include <iostream>
 #include <chrono>
@@ -25,6 +29,29 @@ namespace fs = std::filesystem;
 namespace OB
 {
 
+// decode utf-8 into codepoints, invalid sequences are skipped
+static std::u32string codepoints(std::string_view const str)
+{
+  std::u32string res;
+  res.reserve(str.size());
+
+  auto const data = reinterpret_cast<std::uint8_t const*>(str.data());
+  auto const size = static_cast<std::int32_t>(str.size());
+
+  for (std::int32_t i = 0; i < size;)
+  {
+    UChar32 ch;
+    U8_NEXT(data, i, size, ch);
+
+    if (ch >= 0)
+    {
+      res += static_cast<char32_t>(ch);
+    }
+  }
+
+  return res;
+}
+
 Readline& Readline::style(std::string const& style)
 {
   _style.input = style;
@@ -115,24 +142,71 @@ void Readline::refresh()
     }
   }
 
-  std::cout
-  << aec::cursor_hide
-  << aec::cr
-  << aec::erase_line
-  << _style.input
-  << OB::String::repeat(_width, " ")
-  << aec::cr
-  << _prompt.lhs
-  << _style.input
-  << _input.fmt
-  << aec::clear
-  << _prompt.rhs
-  << aec::cursor_set(_input.cur + 2, _height)
-  << aec::cursor_show
-  << std::flush;
+  draw();
 }
 
-std::string Readline::operator()(bool& is_running)
+void Readline::draw()
+{
+  auto& shown = _input.shown;
+
+  if (shown.valid && shown.lhs == _prompt.lhs && shown.rhs == _prompt.rhs)
+  {
+    // only write from the first grapheme that changed
+    std::size_t same {0};
+    auto const size = std::min(shown.fmt.size(), _input.fmt.size());
+
+    while (same < size && shown.fmt.at(same).str == _input.fmt.at(same).str)
+    {
+      ++same;
+    }
+
+    auto const old_cols = shown.fmt.cols();
+    auto const new_cols = _input.fmt.cols();
+
+    if (same < shown.fmt.size() || same < _input.fmt.size())
+    {
+      auto const col = same ? _input.fmt.cols(0, same) : 0;
+
+      std::cout
+      << aec::cursor_hide
+      << aec::cursor_set(col + 2, _height)
+      << _style.input
+      << _input.fmt.substr(same, OB::Text::String::npos)
+      << (old_cols > new_cols ? OB::String::repeat(old_cols - new_cols, " ") : "")
+      << aec::clear;
+    }
+
+    std::cout
+    << aec::cursor_set(_input.cur + 2, _height)
+    << aec::cursor_show
+    << std::flush;
+  }
+  else
+  {
+    std::cout
+    << aec::cursor_hide
+    << aec::cr
+    << aec::erase_line
+    << _style.input
+    << OB::String::repeat(_width, " ")
+    << aec::cr
+    << _prompt.lhs
+    << _style.input
+    << _input.fmt
+    << aec::clear
+    << _prompt.rhs
+    << aec::cursor_set(_input.cur + 2, _height)
+    << aec::cursor_show
+    << std::flush;
+  }
+
+  shown.valid = true;
+  shown.lhs = _prompt.lhs;
+  shown.rhs = _prompt.rhs;
+  shown.fmt = _input.fmt;
+}
+
+void Readline::begin()
 {
   // update width and height of terminal
   OB::Term::size(_width, _height);
@@ -140,18 +214,6 @@ std::string Readline::operator()(bool& is_running)
   // reset input struct
   _input = {};
 
-  // input key as 32-bit char
-  char32_t ch {0};
-
-  // input key as utf8 string
-  // contains 1-4 bytes
-  std::string utf8;
-
-  bool loop {true};
-  bool save_input {true};
-  bool clear_input {false};
-  auto wait {std::chrono::milliseconds(50)};
-
   std::cout
   << aec::cr
   << aec::erase_line
@@ -160,142 +222,149 @@ std::string Readline::operator()(bool& is_running)
   << aec::cr
   << _prompt.fmt
   << std::flush;
+}
 
-  while (loop && is_running)
-  {
-    std::this_thread::sleep_for(wait);
+void Readline::redraw()
+{
+  OB::Term::size(_width, _height);
 
-    while ((ch = OB::Term::get_key(&utf8)) > 0)
-    {
-      switch (ch)
-      {
-        case OB::Term::Key::escape:
-        {
-          // exit the command prompt
-          loop = false;
-          clear_input = true;
+  _input.shown = {};
 
-          break;
-        }
+  std::cout
+  << aec::cursor_set(0, _height);
 
-        case OB::Term::Key::tab:
-        {
-          // TODO add tab completion
+  refresh();
+}
 
-          break;
-        }
+bool Readline::feed(char32_t const ch, std::string const& utf8)
+{
+  if (ch != OB::Term::Key::tab)
+  {
+    comp_reset();
+  }
 
-        case OB::Term::ctrl_key('c'):
-        {
-          // exit the command prompt
-          loop = false;
-          save_input = false;
-          clear_input = true;
+  switch (ch)
+  {
+    case OB::Term::Key::escape:
+    {
+      // exit the command prompt
+      _input.clear = true;
 
-          break;
-        }
+      return false;
+    }
 
-        case OB::Term::ctrl_key('u'):
-        {
-          edit_clear();
+    case OB::Term::Key::tab:
+    {
+      comp_next();
 
-          break;
-        }
+      return true;
+    }
 
-        case OB::Term::Key::newline:
-        {
-          // submit the input string
-          loop = false;
+    case OB::Term::ctrl_key('c'):
+    {
+      // exit the command prompt
+      _input.save = false;
+      _input.clear = true;
 
-          break;
-        }
+      return false;
+    }
 
-        case OB::Term::Key::up:
-        case OB::Term::ctrl_key('p'):
-        {
-          hist_prev();
+    case OB::Term::ctrl_key('u'):
+    {
+      edit_clear();
 
-          break;
-        }
+      return true;
+    }
 
-        case OB::Term::Key::down:
-        case OB::Term::ctrl_key('n'):
-        {
-          hist_next();
+    case OB::Term::Key::newline:
+    {
+      // submit the input string
+      return false;
+    }
 
-          break;
-        }
+    case OB::Term::Key::up:
+    case OB::Term::ctrl_key('p'):
+    {
+      hist_prev();
 
-        case OB::Term::Key::right:
-        case OB::Term::ctrl_key('f'):
-        {
-          curs_right();
+      return true;
+    }
 
-          break;
-        }
+    case OB::Term::Key::down:
+    case OB::Term::ctrl_key('n'):
+    {
+      hist_next();
 
-        case OB::Term::Key::left:
-        case OB::Term::ctrl_key('b'):
-        {
-          curs_left();
+      return true;
+    }
 
-          break;
-        }
+    case OB::Term::Key::right:
+    case OB::Term::ctrl_key('f'):
+    {
+      curs_right();
 
-        case OB::Term::Key::end:
-        case OB::Term::ctrl_key('e'):
-        {
-          curs_end();
+      return true;
+    }
 
-          break;
-        }
+    case OB::Term::Key::left:
+    case OB::Term::ctrl_key('b'):
+    {
+      curs_left();
 
-        case OB::Term::Key::home:
-        case OB::Term::ctrl_key('a'):
-        {
-          curs_begin();
+      return true;
+    }
 
-          break;
-        }
+    case OB::Term::Key::end:
+    case OB::Term::ctrl_key('e'):
+    {
+      curs_end();
 
-        case OB::Term::Key::delete_:
-        case OB::Term::ctrl_key('d'):
-        {
-          loop = edit_delete();
+      return true;
+    }
 
-          break;
-        }
+    case OB::Term::Key::home:
+    case OB::Term::ctrl_key('a'):
+    {
+      curs_begin();
 
-        case OB::Term::Key::backspace:
-        case OB::Term::ctrl_key('h'):
-        {
-          loop = edit_backspace();
+      return true;
+    }
 
-          break;
-        }
+    case OB::Term::Key::delete_:
+    case OB::Term::ctrl_key('d'):
+    {
+      return edit_delete();
+    }
 
-        default:
-        {
-          if (ch < 0xF0000 && (ch == OB::Term::Key::space || OB::Text::is_graph(static_cast<std::int32_t>(ch))))
-          {
-            edit_insert(utf8);
-          }
+    case OB::Term::Key::backspace:
+    case OB::Term::ctrl_key('h'):
+    {
+      return edit_backspace();
+    }
 
-          break;
-        }
+    default:
+    {
+      if (ch < 0xF0000 && (ch == OB::Term::Key::space || OB::Text::is_graph(static_cast<std::int32_t>(ch))))
+      {
+        edit_insert(utf8);
       }
+
+      return true;
     }
   }
+}
 
+std::string Readline::end()
+{
   auto res = normalize(_input.str);
 
-  if (save_input)
+  if (_input.save)
   {
     hist_push(res);
     hist_save(res);
   }
 
-  if (clear_input)
+  if (_input.clear)
   {
     res.clear();
   }
@@ -303,6 +372,56 @@ std::string Readline::operator()(bool& is_running)
   return res;
 }
 
+std::string Readline::str() const
+{
+  return _input.str.str();
+}
+
+std::string Readline::operator()(bool& is_running)
+{
+  begin();
+
+  // input key as utf8 string
+  // contains 1-4 bytes
+  std::string utf8;
+
+  while (is_running)
+  {
+    // handle each key as soon as it arrives
+    if (! OB::Term::wait_input())
+    {
+      if (OB::Term::input_closed())
+      {
+        is_running = false;
+
+        break;
+      }
+
+      if (OB::Term::Winch::changed())
+      {
+        redraw();
+      }
+
+      continue;
+    }
+
+    char32_t ch {0};
+    bool open {true};
+
+    while (open && (ch = OB::Term::get_key(&utf8)) > 0)
+    {
+      open = feed(ch, utf8);
+    }
+
+    if (! open)
+    {
+      break;
+    }
+  }
+
+  return end();
+}
+
 void Readline::curs_begin()
 {
   // move cursor to start of line
@@ -499,13 +618,13 @@ void Readline::hist_prev()
 {
   // cycle backwards in history
 
-  if (_history().empty() && _history.search().empty())
+  if (_history.empty() && _history.search().empty())
   {
     return;
   }
 
   bool bounds {_history.search().empty() ?
-    (_history.idx < _history().size() - 1) :
+    (_history.idx < _history.size() - 1) :
     (_history.idx < _history.search().size() - 1)};
 
   if (bounds || _history.idx == History::npos)
@@ -525,26 +644,15 @@ void Readline::hist_prev()
     if (_history.search().empty())
     {
       // normal search
-      _input.str = _history().at(_history.idx);
+      _input.str = _history.at(_history.idx);
     }
     else
     {
       // fuzzy search
-      _input.str = _history().at(_history.search().at(_history.idx).idx);
-    }
-
-    if (_input.str.size() + 1 >= _width)
-    {
-      _input.off = _input.str.size() - _width + 2;
-      _input.idx = _width - 2;
-    }
-    else
-    {
-      _input.off = 0;
-      _input.idx = _input.str.size();
+      _input.str = _history.at(_history.search().at(_history.idx).idx);
     }
 
-    refresh();
+    curs_set_end();
   }
 }
 
@@ -563,27 +671,138 @@ void Readline::hist_next()
     else if (_history.search().empty())
     {
       // normal search
-      _input.str = _history().at(_history.idx);
+      _input.str = _history.at(_history.idx);
     }
     else
     {
       // fuzzy search
-      _input.str = _history().at(_history.search().at(_history.idx).idx);
+      _input.str = _history.at(_history.search().at(_history.idx).idx);
     }
 
-    if (_input.str.size() + 1 >= _width)
+    curs_set_end();
+  }
+}
+
+void Readline::curs_set_end()
+{
+  // show the end of a replaced line with the cursor after it
+
+  if (_input.str.size() + 1 >= _width)
+  {
+    _input.off = _input.str.size() - _width + 2;
+    _input.idx = _width - 2;
+  }
+  else
+  {
+    _input.off = 0;
+    _input.idx = _input.str.size();
+  }
+
+  refresh();
+}
+
+void Readline::complete(Completer const& completer)
+{
+  _complete.completer = completer;
+}
+
+void Readline::comp_next()
+{
+  auto& comp = _complete;
+
+  // further tabs cycle through the candidates of the first one
+  if (comp.active)
+  {
+    comp.idx = (comp.idx + 1) % comp.list.size();
+    _input.str = comp.list.at(comp.idx);
+    curs_set_end();
+
+    return;
+  }
+
+  auto const line = _input.str.str();
+
+  comp.list = comp.completer ? comp.completer(line) : std::vector<std::string> {};
+
+  // previous lines starting with the input, from the sorted history
+  if (! line.empty())
+  {
+    auto const& sorted = hist_sorted();
+
+    for (auto it = std::lower_bound(sorted.begin(), sorted.end(), std::string_view(line));
+      it != sorted.end() && it->substr(0, line.size()) == line; ++it)
     {
-      _input.off = _input.str.size() - _width + 2;
-      _input.idx = _width - 2;
+      if (it->size() > line.size())
+      {
+        comp.list.emplace_back(*it);
+      }
     }
-    else
+
+    std::sort(comp.list.begin(), comp.list.end());
+    comp.list.erase(std::unique(comp.list.begin(), comp.list.end()), comp.list.end());
+  }
+
+  if (comp.list.empty())
+  {
+    return;
+  }
+
+  // extend the input as far as all candidates agree
+  auto common = comp.list.front().size();
+
+  for (auto const& e : comp.list)
+  {
+    auto const end = std::mismatch(e.begin(), e.begin() + static_cast<std::ptrdiff_t>(std::min(common, e.size())),
+      comp.list.front().begin()).first;
+    common = static_cast<std::size_t>(end - e.begin());
+  }
+
+  // never stop inside a multi-byte character
+  while (common && common < comp.list.front().size() &&
+    (static_cast<unsigned char>(comp.list.front()[common]) & 0xC0) == 0x80)
+  {
+    --common;
+  }
+
+  if (comp.list.size() == 1 || common > line.size())
+  {
+    _input.str = comp.list.size() == 1 ? comp.list.front() : comp.list.front().substr(0, common);
+    comp.list.clear();
+  }
+  else
+  {
+    comp.active = true;
+    comp.idx = 0;
+    _input.str = comp.list.front();
+  }
+
+  curs_set_end();
+  hist_reset();
+}
+
+void Readline::comp_reset()
+{
+  _complete.active = false;
+  _complete.list.clear();
+}
+
+std::vector<std::string_view> const& Readline::hist_sorted()
+{
+  if (_history.sorted_dirty)
+  {
+    _history.sorted.clear();
+    _history.sorted.reserve(_history.val.size());
+
+    for (auto const& e : _history.val)
     {
-      _input.off = 0;
-      _input.idx = _input.str.size();
+      _history.sorted.emplace_back(e.str);
     }
 
-    refresh();
+    std::sort(_history.sorted.begin(), _history.sorted.end());
+    _history.sorted_dirty = false;
   }
+
+  return _history.sorted;
 }
 
 void Readline::hist_reset()
@@ -596,9 +815,7 @@ void Readline::hist_search(std::string const& str)
 {
   _history.search.clear();
 
-  OB::Text::String input {OB::Text::normalize_foldcase(
-    std::regex_replace(OB::Text::trim(str), std::regex("\\s+"),
-    " ", std::regex_constants::match_not_null))};
+  auto const input = codepoints(OB::Text::normalize_foldcase(normalize(str)));
 
   if (input.empty())
   {
@@ -608,13 +825,12 @@ void Readline::hist_search(std::string const& str)
   std::size_t idx {0};
   std::size_t count {0};
   std::size_t weight {0};
-  std::string prev_hist {" "};
-  std::string prev_input {" "};
-  OB::Text::String hist;
+  char32_t prev_hist {U' '};
+  char32_t prev_input {U' '};
 
-  for (std::size_t i = 0; i < _history().size(); ++i)
+  for (std::size_t i = 0; i < _history.size(); ++i)
   {
-    hist.str(OB::Text::normalize_foldcase(_history().at(i)));
+    auto const& hist = _history.entry(i).key;
 
     if (hist.size() <= input.size())
     {
@@ -624,13 +840,12 @@ void Readline::hist_search(std::string const& str)
     idx = 0;
     count = 0;
     weight = 0;
-    prev_hist = " ";
-    prev_input = " ";
+    prev_hist = U' ';
+    prev_input = U' ';
 
     for (std::size_t j = 0, seq = 0; j < hist.size(); ++j)
     {
-      if (idx < input.size() &&
-        hist.at(j).str == input.at(idx).str)
+      if (idx < input.size() && hist[j] == input[idx])
       {
         ++seq;
         count += 1;
@@ -640,12 +855,12 @@ void Readline::hist_search(std::string const& str)
           count += 1;
         }
 
-        if (prev_hist == " " && prev_input == " ")
+        if (prev_hist == U' ' && prev_input == U' ')
         {
           count += 1;
         }
 
-        prev_input = input.at(idx).str;
+        prev_input = input[idx];
         ++idx;
 
         // short circuit to keep history order
@@ -660,13 +875,13 @@ void Readline::hist_search(std::string const& str)
         seq = 0;
         weight += 2;
 
-        if (prev_input == " ")
+        if (prev_input == U' ')
         {
           weight += 1;
         }
       }
 
-      prev_hist = hist.at(j).str;
+      prev_hist = hist[j];
     }
 
     if (idx != input.size())
@@ -683,49 +898,180 @@ void Readline::hist_search(std::string const& str)
     _history.search().emplace_back(weight, i);
   }
 
-  std::sort(_history.search().begin(), _history.search().end(),
+  // only the best results are ever cycled through
+  auto& res = _history.search();
+  auto const size = std::min(res.size(), History::Search::limit);
+
+  std::partial_sort(res.begin(), res.begin() + static_cast<std::ptrdiff_t>(size), res.end(),
   [](auto const& lhs, auto const& rhs)
   {
     // default to history order if score is equal
     return lhs.score == rhs.score ? lhs.idx < rhs.idx : lhs.score < rhs.score;
   });
+
+  res.erase(res.begin() + static_cast<std::ptrdiff_t>(size), res.end());
 }
 
 void Readline::hist_push(std::string const& str)
 {
-  if (! str.empty() && ! (! _history().empty() && _history().back() == str))
+  if (! str.empty())
   {
-    if (auto pos = std::find(_history().begin(), _history().end(), str); pos != _history().end())
+    if (auto const it = _history.set.find(str); it != _history.set.end())
+    {
+      // move the existing entry to the front
+      _history.val.splice(_history.val.begin(), _history.val, it->second);
+    }
+    else
     {
-      _history().erase(pos);
+      _history.val.emplace_front(History::Entry {str, codepoints(OB::Text::normalize_foldcase(str))});
+      _history.set.emplace(_history.val.front().str, _history.val.begin());
+      hist_trim();
+      _history.sorted_dirty = true;
     }
 
-    _history().emplace_front(str);
+    _history.dirty = true;
   }
 
   hist_reset();
 }
 
+void Readline::hist_trim()
+{
+  while (_history.max && _history.val.size() > _history.max)
+  {
+    _history.set.erase(_history.val.back().str);
+    _history.val.pop_back();
+    _history.dirty = true;
+    _history.sorted_dirty = true;
+  }
+}
+
+void Readline::hist_size(std::size_t const size)
+{
+  _history.max = size;
+  hist_trim();
+  hist_reset();
+}
+
+std::size_t Readline::hist_size()
+{
+  return _history.max;
+}
+
+// unique entries of a history file most recent first, at most 'max' when set,
+// 'lines' is set to the number of lines read
+static std::vector<std::string> hist_read(fs::path const& path, std::size_t const max, std::size_t& lines)
+{
+  std::vector<std::string> res;
+  std::vector<std::string> file;
+  lines = 0;
+
+  std::ifstream ifile {path};
+
+  if (! ifile || ! ifile.is_open())
+  {
+    return res;
+  }
+
+  std::string line;
+
+  while (std::getline(ifile, line))
+  {
+    file.emplace_back(std::move(line));
+  }
+
+  lines = file.size();
+
+  // lines are appended, so the last occurrence is the most recent
+  std::unordered_map<std::string_view, bool> seen;
+
+  for (auto it = file.rbegin(); it != file.rend() && ! (max && res.size() >= max); ++it)
+  {
+    if (it->empty() || ! seen.emplace(*it, true).second)
+    {
+      continue;
+    }
+
+    res.emplace_back(*it);
+  }
+
+  return res;
+}
+
+// replace the history file with 'entries', oldest line first
+static bool hist_write(fs::path const& path, std::vector<std::string> const& entries)
+{
+  auto tmp = path;
+  tmp += ".tmp";
+
+  {
+    std::ofstream ofile {tmp, std::ios::trunc};
+
+    if (! ofile.is_open())
+    {
+      return false;
+    }
+
+    for (auto it = entries.rbegin(); it != entries.rend(); ++it)
+    {
+      ofile << *it << "\n";
+    }
+
+    if (! ofile.flush())
+    {
+      return false;
+    }
+  }
+
+  std::error_code ec;
+  fs::rename(tmp, path, ec);
+
+  return ! ec;
+}
+
 void Readline::hist_load(fs::path const& path)
 {
   if (! path.empty())
   {
-    std::ifstream ifile {path};
+    std::size_t lines {0};
+    auto const entries = hist_read(path, _history.max, lines);
 
-    if (ifile && ifile.is_open())
+    for (auto it = entries.rbegin(); it != entries.rend(); ++it)
     {
-      std::string line;
+      hist_push(*it);
+    }
 
-      while (std::getline(ifile, line))
-      {
-        hist_push(line);
-      }
+    // drop duplicates and old entries so the next load reads only what it keeps
+    if (lines > entries.size())
+    {
+      hist_write(path, entries);
     }
 
+    _history.path = path;
     hist_open(path);
   }
 }
 
+void Readline::hist_compact()
+{
+  if (_history.path.empty())
+  {
+    return;
+  }
+
+  // reread the file, other instances may have appended to it
+  std::size_t lines {0};
+  auto const entries = hist_read(_history.path, _history.max, lines);
+
+  if (lines > entries.size())
+  {
+    _history.file.close();
+
+    hist_write(_history.path, entries);
+    hist_open(_history.path);
+  }
+}
+
 void Readline::hist_save(std::string const& str)
 {
   if (_history.file.is_open())
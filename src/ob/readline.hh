@@ -5,10 +5,14 @@
 
 #include <cstddef>
 
-#include <deque>
+#include <list>
+#include <vector>
 #include <string>
+#include <string_view>
+#include <unordered_map>
 #include <limits>
 #include <fstream>
+#include <functional>
 
 #include <filesystem>
 namespace fs = std::filesystem;
@@ -25,19 +29,50 @@ public:
   Readline& style(std::string const& style = {});
   Readline& prompt(std::string const& str, std::string const& style = {});
 
+  // read a line, waiting on the terminal until it is submitted or cancelled
   std::string operator()(bool& is_running);
 
+  // the same prompt driven one key at a time by the caller's input loop,
+  // feed returns false once the line is submitted or cancelled,
+  // end then returns the line, empty when cancelled
+  void begin();
+  bool feed(char32_t const ch, std::string const& utf8);
+  std::string end();
+
+  // redraw after the terminal was resized or the screen drawn over
+  void redraw();
+
+  // current input line
+  std::string str() const;
+
+  // full lines that complete the input on tab, history lines starting
+  // with the input are added to them, a repeated tab cycles through them
+  using Completer = std::function<std::vector<std::string>(std::string const& str)>;
+  void complete(Completer const& completer);
+
   void hist_push(std::string const& str);
   void hist_load(fs::path const& path);
 
+  // maximum number of entries kept, 0 for no limit
+  void hist_size(std::size_t const size);
+  std::size_t hist_size();
+
+  // rewrite the history file with only the entries that would be loaded from it
+  void hist_compact();
+
 private:
 
   void refresh();
+  void draw();
 
   void curs_begin();
   void curs_end();
   void curs_left();
   void curs_right();
+  void curs_set_end();
+
+  void comp_next();
+  void comp_reset();
 
   void edit_insert(std::string const& str);
   void edit_clear();
@@ -50,6 +85,8 @@ private:
   void hist_search(std::string const& str);
   void hist_open(fs::path const& path);
   void hist_save(std::string const& str);
+  void hist_trim();
+  std::vector<std::string_view> const& hist_sorted();
 
   std::string normalize(std::string const& str) const;
 
@@ -79,6 +116,19 @@ private:
     std::string buf;
     OB::Text::String str;
     OB::Text::String fmt;
+
+    // add the line to the history, and return it, when the prompt ends
+    bool save {true};
+    bool clear {false};
+
+    // what is on the screen, so a redraw only writes what changed
+    struct Shown
+    {
+      bool valid {false};
+      std::string lhs;
+      std::string rhs;
+      OB::Text::String fmt;
+    } shown;
   } _input;
 
   struct History
@@ -99,7 +149,10 @@ private:
         std::size_t idx {0};
       };
 
-      using value_type = std::deque<Result>;
+      using value_type = std::vector<Result>;
+
+      // results kept, best first
+      static std::size_t constexpr limit {256};
 
       value_type& operator()()
       {
@@ -121,18 +174,79 @@ private:
       value_type val;
     } search;
 
-    using value_type = std::deque<std::string>;
+    struct Entry
+    {
+      std::string str;
+
+      // normalised and case folded codepoints, matched against by search
+      std::u32string key;
+    };
+
+    // most recent first, each entry once
+    using value_type = std::list<Entry>;
+
+    bool empty() const
+    {
+      return val.empty();
+    }
+
+    std::size_t size() const
+    {
+      return val.size();
+    }
+
+    std::string const& at(std::size_t const i)
+    {
+      return entry(i).str;
+    }
 
-    value_type& operator()()
+    Entry const& entry(std::size_t const i)
     {
-      return val;
+      if (dirty)
+      {
+        pos.clear();
+        pos.reserve(val.size());
+
+        for (auto const& e : val)
+        {
+          pos.emplace_back(&e);
+        }
+
+        dirty = false;
+      }
+
+      return *pos.at(i);
     }
 
     value_type val;
+
+    // entries by value, the views point into the list nodes
+    std::unordered_map<std::string_view, value_type::iterator> set;
+
+    // entries by position, rebuilt on first access after a change
+    std::vector<Entry const*> pos;
+    bool dirty {false};
+
+    // entries in byte order for prefix lookups, rebuilt on first use after a change
+    std::vector<std::string_view> sorted;
+    bool sorted_dirty {false};
+
+    std::size_t max {10000};
     std::size_t idx {npos};
 
+    fs::path path;
     std::ofstream file;
   } _history;
+
+  struct Complete
+  {
+    Completer completer;
+
+    // candidates being cycled through and the one shown
+    bool active {false};
+    std::vector<std::string> list;
+    std::size_t idx {0};
+  } _complete;
 };
 
 } // namespace OB
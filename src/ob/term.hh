@@ -1,16 +1,22 @@
 #ifndef OB_TERM_HH
 #define OB_TERM_HH
 
+#include <poll.h>
+#include <fcntl.h>
 #include <unistd.h>
 #include <termios.h>
 #include <sys/ioctl.h>
 
+#include <cerrno>
+#include <csignal>
 #include <cstdio>
 #include <cctype>
 #include <cstddef>
 #include <cstdint>
 #include <cstdlib>
 
+#include <array>
+#include <atomic>
 #include <iomanip>
 #include <streambuf>
 #include <iostream>
@@ -110,358 +116,558 @@ inline char32_t utf8_to_char32(std::string_view str)
   return 0;
 }
 
-inline char32_t get_key(std::string* str = nullptr)
+// terminal resize notification
+// while an instance exists, SIGWINCH marks the size as changed
+// and wakes wait_input through a self-pipe
+class Winch
 {
-  // NOTE term mode should be in raw state before call to this func
+public:
+
+  Winch()
+  {
+    if (pipe(_fd) == -1)
+    {
+      throw std::runtime_error("pipe failed");
+    }
+
+    for (auto const fd : _fd)
+    {
+      fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK);
+      fcntl(fd, F_SETFD, FD_CLOEXEC);
+    }
 
-  char key[4] {0};
-  int ec = read(STDIN_FILENO, &key[0], 1);
+    struct sigaction sa {};
+    sa.sa_handler = &Winch::handler;
+    sigemptyset(&sa.sa_mask);
 
-  if ((ec == -1) && (errno != EAGAIN))
+    if (sigaction(SIGWINCH, &sa, &_old) == -1)
+    {
+      throw std::runtime_error("sigaction failed");
+    }
+
+    _changed = true;
+  }
+
+  ~Winch()
   {
-    throw std::runtime_error("read failed");
+    sigaction(SIGWINCH, &_old, nullptr);
+
+    close(_fd[0]);
+    close(_fd[1]);
+
+    _fd[0] = -1;
+    _fd[1] = -1;
   }
 
-  if (ec == 0)
+  Winch(Winch const&) = delete;
+  Winch& operator=(Winch const&) = delete;
+
+  // true once after each resize
+  static bool changed()
   {
-    return Key::null;
+    return _changed.exchange(false);
   }
 
-  // utf-8 multibyte code point
-  if (key[0] & 0x80)
+  // read end of the self-pipe, -1 when not active
+  static int fd()
   {
-    std::size_t bytes {0};
+    return _fd[0];
+  }
+
+  // empty the self-pipe after a wakeup
+  static void drain()
+  {
+    char buf[64];
+    while (read(_fd[0], &buf[0], sizeof(buf)) > 0);
+  }
+
+private:
+
+  static void handler(int)
+  {
+    auto const err = errno;
+
+    _changed = true;
+    [[maybe_unused]] auto const ec = write(_fd[1], "", 1);
 
-    for (; bytes < 3; ++bytes)
+    errno = err;
+  }
+
+  inline static std::atomic<bool> _changed {false};
+  inline static int _fd[2] {-1, -1};
+  struct sigaction _old {};
+}; // class Winch
+
+// buffered key decoder
+// reads all available input with a single read call and decodes keys,
+// utf-8 code points and escape/mouse sequences from the buffer,
+// a sequence split across reads is kept until it completes or times out
+class Input
+{
+public:
+
+  using Clock = std::chrono::steady_clock;
+
+  // time to wait for the rest of a split sequence
+  static auto constexpr timeout = std::chrono::milliseconds(25);
+
+  char32_t get(std::string* str = nullptr)
+  {
+    // NOTE term mode should be in raw state before call to this func
+
+    if (auto const key = decode(str, false); key != Key::null)
     {
-      if (! (key[0] & (0x80 >> (bytes + 1))))
-      {
-        break;
-      }
+      return key;
     }
 
-    if ((ec = read(STDIN_FILENO, &key[1], bytes)) != static_cast<int>(bytes))
+    fill();
+
+    if (auto const key = decode(str, false); key != Key::null)
     {
-      if ((ec == -1) && (errno != EAGAIN))
-      {
-        throw std::runtime_error("read failed");
-      }
+      return key;
+    }
 
-      return static_cast<char32_t>(key[0]);
+    // give up on a split sequence once it has waited long enough
+    if (_begin != _end && Clock::now() - _since >= timeout)
+    {
+      return decode(str, true);
     }
 
-    ++bytes;
+    _partial = _begin != _end;
 
-    if (str != nullptr)
+    return Key::null;
+  }
+
+  // time until the buffer needs decoding, 0 when a key may be ready,
+  // -1 when the buffer is empty
+  int pending() const
+  {
+    if (_begin == _end)
     {
-      str->assign(&key[0], bytes);
+      return -1;
     }
 
-    return utf8_to_char32(std::string_view(&key[0], bytes));
+    if (! _partial)
+    {
+      return 0;
+    }
+
+    auto const left = std::chrono::ceil<std::chrono::milliseconds>(_since + timeout - Clock::now()).count();
+
+    return left > 0 ? static_cast<int>(left) : 0;
   }
 
-  // utf-8 single-byte code point
-  if (str != nullptr)
+  // the terminal hung up or stdin failed, no more input will arrive
+  bool closed() const
   {
-    str->assign(&key[0], 1);
+    return _closed;
   }
 
-  // esc / esc sequence
-  if (key[0] == Key::escape)
+  void close()
   {
-    char seq[3] {0};
+    _closed = true;
+  }
 
-    if ((ec = read(STDIN_FILENO, &seq[0], 1)) != 1)
+private:
+
+  void fill()
+  {
+    // keep the unread bytes at the front of the buffer
+    if (_begin == _end)
+    {
+      _begin = _end = 0;
+    }
+    else if (_begin > 0)
     {
-      if ((ec == -1) && (errno != EAGAIN))
+      std::copy(_buf.begin() + static_cast<std::ptrdiff_t>(_begin),
+        _buf.begin() + static_cast<std::ptrdiff_t>(_end), _buf.begin());
+      _end -= _begin;
+      _begin = 0;
+    }
+
+    if (_end == _buf.size())
+    {
+      return;
+    }
+
+    auto const ec = read(STDIN_FILENO, &_buf[_end], _buf.size() - _end);
+
+    if (ec == -1)
+    {
+      if (errno != EAGAIN && errno != EINTR)
       {
         throw std::runtime_error("read failed");
       }
 
-      return static_cast<char32_t>(key[0]);
+      return;
     }
 
-    if ((ec = read(STDIN_FILENO, &seq[1], 1)) != 1)
+    // start of a possibly split sequence
+    if (_begin == _end)
     {
-      if ((ec == -1) && (errno != EAGAIN))
+      _since = Clock::now();
+    }
+
+    _end += static_cast<std::size_t>(ec);
+  }
+
+  // decode the next key in the buffer,
+  // returns null if the buffer is empty or holds an incomplete sequence,
+  // unless flush is set, in which case the partial sequence is consumed
+  char32_t decode(std::string* str, bool const flush)
+  {
+    if (_begin == _end)
+    {
+      return Key::null;
+    }
+
+    std::string_view const buf {&_buf[_begin], _end - _begin};
+    auto const ch = static_cast<unsigned char>(buf[0]);
+
+    // consume n bytes and return the key
+    auto const take = [&](std::size_t const n, char32_t const key) {
+      if (str != nullptr)
       {
-        throw std::runtime_error("read failed");
+        str->assign(buf.substr(0, n));
+      }
+
+      _begin += n;
+      _partial = false;
+
+      if (_begin != _end)
+      {
+        _since = Clock::now();
       }
 
-      return static_cast<char32_t>(key[0]);
+      return key;
+    };
+
+    // utf-8 multibyte code point
+    if (ch & 0x80)
+    {
+      std::size_t bytes {1};
+
+      if ((ch & 0xE0) == 0xC0)
+      {
+        bytes = 2;
+      }
+      else if ((ch & 0xF0) == 0xE0)
+      {
+        bytes = 3;
+      }
+      else if ((ch & 0xF8) == 0xF0)
+      {
+        bytes = 4;
+      }
+
+      if (bytes == 1 || (buf.size() < bytes && flush))
+      {
+        return take(1, ch);
+      }
+
+      if (buf.size() < bytes)
+      {
+        return Key::null;
+      }
+
+      return take(bytes, utf8_to_char32(buf.substr(0, bytes)));
     }
 
-    if (seq[0] == '[')
+    // utf-8 single-byte code point
+    if (ch != Key::escape)
     {
-      if (seq[1] >= '0' && seq[1] <= '9')
+      return take(1, ch);
+    }
+
+    // esc / esc sequence
+    if (buf.size() == 1)
+    {
+      // a lone escape is only known once the rest of a sequence fails to arrive,
+      // when the read drained the input it was a keypress
+      if (! flush && _end >= _buf.size())
       {
-        if ((ec = read(STDIN_FILENO, &seq[2], 1)) != 1)
-        {
-          if ((ec == -1) && (errno != EAGAIN))
-          {
-            throw std::runtime_error("read failed");
-          }
+        return Key::null;
+      }
 
-          return static_cast<char32_t>(key[0]);
-        }
+      return take(1, Key::escape);
+    }
+
+    if (buf[1] != '[')
+    {
+      // unsupported sequence, consume it along with the escape
+      auto const size = buf[1] == 'O' ? std::size_t {3} : std::size_t {2};
+
+      if (buf.size() < size && ! flush)
+      {
+        return Key::null;
+      }
+
+      return take(std::min(size, buf.size()), Key::escape);
+    }
+
+    // control sequence introducer
+    if (buf.size() == 2)
+    {
+      if (! flush)
+      {
+        return Key::null;
+      }
+
+      return take(2, Key::escape);
+    }
 
-        if (seq[2] == '~')
+    // 1000 mouse event
+    if (buf[2] == 'M')
+    {
+      if (buf.size() < 6)
+      {
+        if (! flush)
         {
-          switch (seq[1])
-          {
-            case '1':
-            {
-              return Key::home;
-            }
+          return Key::null;
+        }
 
-            case '2':
-            {
-              return Key::insert;
-            }
+        return take(buf.size(), Key::escape);
+      }
 
-            case '3':
-            {
-              return Key::delete_;
-            }
+      return take(6, mouse_x10(static_cast<unsigned char>(buf[3])));
+    }
 
-            case '4':
-            {
-              return Key::end;
-            }
+    // find the final byte of the sequence
+    std::size_t constexpr max_size {64};
+    std::size_t end {2};
 
-            case '5':
-            {
-              return Key::page_up;
-            }
+    while (end < buf.size() && end < max_size && ! (buf[end] >= 0x40 && buf[end] <= 0x7E))
+    {
+      ++end;
+    }
 
-            case '6':
-            {
-              return Key::page_down;
-            }
+    if (end == buf.size() && end < max_size)
+    {
+      if (! flush)
+      {
+        return Key::null;
+      }
 
-            default:
-            {
-              return static_cast<char32_t>(key[0]);
-            }
-          }
-        }
+      return take(buf.size(), Key::escape);
+    }
+
+    if (end == max_size)
+    {
+      return take(end, Key::escape);
+    }
+
+    auto const params = buf.substr(2, end - 2);
+    auto const size = end + 1;
+
+    switch (buf[end])
+    {
+      case 'A':
+      {
+        return take(size, params.empty() ? Key::up : Key::escape);
       }
-      else
+
+      case 'B':
       {
-        switch (seq[1])
+        return take(size, params.empty() ? Key::down : Key::escape);
+      }
+
+      case 'C':
+      {
+        return take(size, params.empty() ? Key::right : Key::escape);
+      }
+
+      case 'D':
+      {
+        return take(size, params.empty() ? Key::left : Key::escape);
+      }
+
+      case '~':
+      {
+        if (params.size() == 1)
         {
-          case 'A':
+          switch (params[0])
           {
-            return Key::up;
+            case '1': return take(size, Key::home);
+            case '2': return take(size, Key::insert);
+            case '3': return take(size, Key::delete_);
+            case '4': return take(size, Key::end);
+            case '5': return take(size, Key::page_up);
+            case '6': return take(size, Key::page_down);
+            default: break;
           }
+        }
 
-          case 'B':
-          {
-            return Key::down;
-          }
+        return take(size, Key::escape);
+      }
 
-          case 'C':
-          {
-            return Key::right;
-          }
+      case 'M':
+      case 'm':
+      {
+        // 1000;1006 mouse event
+        if (! params.empty() && params[0] == '<')
+        {
+          return take(size, mouse_sgr(params.substr(1), buf[end] == 'M'));
+        }
 
-          case 'D':
-          {
-            return Key::left;
-          }
+        return take(size, Key::escape);
+      }
 
-          case '<':
-          {
-            // 1000;1006 mouse event
+      default:
+      {
+        return take(size, Key::escape);
+      }
+    }
+  }
 
-            std::size_t constexpr buf_size {64};
-            char mouse[buf_size] {0};
+  static char32_t mouse_x10(unsigned char const btn)
+  {
+    switch (btn & 0x03)
+    {
+      case 0:
+      {
+        return (btn & 0x40) ? Mouse::scroll_up : Mouse::btn1_press;
+      }
 
-            for (std::size_t i = 0; i < buf_size; ++i)
-            {
-              if ((ec = read(STDIN_FILENO, &mouse[i], 1)) != 1)
-              {
-                if ((ec == -1) && (errno != EAGAIN))
-                {
-                  throw std::runtime_error("read failed");
-                }
-
-                return static_cast<char32_t>(key[0]);
-              }
-
-              if (mouse[i] >= 0x40 && mouse[i] <= 0x7E)
-              {
-                if (str != nullptr)
-                {
-                  str->assign(mouse, i + 1);
-                }
-
-                switch (mouse[i])
-                {
-                  case 'm':
-                  {
-                    switch (mouse[0])
-                    {
-                      case '0':
-                      {
-                        return Mouse::btn1_release;
-                      }
-
-                      case '1':
-                      {
-                        return Mouse::btn2_release;
-                      }
-
-                      case '2':
-                      {
-                        return Mouse::btn3_release;
-                      }
-
-                      default:
-                      {
-                        break;
-                      }
-                    }
-
-                    break;
-                  }
-
-                  case 'M':
-                  {
-                    switch (mouse[0])
-                    {
-                      case '0':
-                      {
-                        return Mouse::btn1_press;
-                      }
-
-                      case '1':
-                      {
-                        return Mouse::btn2_press;
-                      }
-
-                      case '2':
-                      {
-                        return Mouse::btn3_press;
-                      }
-
-                      case '6':
-                      {
-                        switch (mouse[1])
-                        {
-                          case '4':
-                          {
-                            return Mouse::scroll_up;
-                          }
-
-                          case '5':
-                          {
-                            return Mouse::scroll_down;
-                          }
-
-                          default:
-                          {
-                            break;
-                          }
-                        }
-
-                        break;
-                      }
-
-                      default:
-                      {
-                        break;
-                      }
-                    }
-
-                    break;
-                  }
-
-                  default:
-                  {
-                    break;
-                  }
-                }
-
-                break;
-              }
-            }
+      case 1:
+      {
+        return (btn & 0x40) ? Mouse::scroll_down : Mouse::btn2_press;
+      }
 
-            return static_cast<char32_t>(key[0]);
-          }
+      case 2:
+      {
+        return Mouse::btn3_press;
+      }
 
-          case 'M':
-          {
-            // 1000 mouse event
+      default:
+      {
+        return Mouse::btn_release;
+      }
+    }
+  }
 
-            char mouse[3] {0};
+  static char32_t mouse_sgr(std::string_view const params, bool const press)
+  {
+    // button number is the first parameter
+    auto const btn = params.substr(0, params.find(';'));
 
-            if ((ec = read(STDIN_FILENO, &mouse[0], 3)) != 3)
-            {
-              if ((ec == -1) && (errno != EAGAIN))
-              {
-                throw std::runtime_error("read failed");
-              }
+    if (press)
+    {
+      if (btn == "0") return Mouse::btn1_press;
+      if (btn == "1") return Mouse::btn2_press;
+      if (btn == "2") return Mouse::btn3_press;
+      if (btn == "64") return Mouse::scroll_up;
+      if (btn == "65") return Mouse::scroll_down;
+    }
+    else
+    {
+      if (btn == "0") return Mouse::btn1_release;
+      if (btn == "1") return Mouse::btn2_release;
+      if (btn == "2") return Mouse::btn3_release;
+    }
 
-              return static_cast<char32_t>(key[0]);
-            }
+    return Key::escape;
+  }
 
-            if (str != nullptr)
-            {
-              str->assign(mouse, 3);
-            }
+  std::array<char, 4096> _buf {};
+  std::size_t _begin {0};
+  std::size_t _end {0};
 
-            switch (mouse[0] & 0x03)
-            {
-              case 0:
-              {
-                if (mouse[0] & 0x40)
-                {
-                  return Mouse::scroll_up;
-                }
-
-                return Mouse::btn1_press;
-              }
-
-              case 1:
-              {
-                if (mouse[0] & 0x40)
-                {
-                  return Mouse::scroll_down;
-                }
-
-                return Mouse::btn2_press;
-              }
-
-              case 2:
-              {
-                return Mouse::btn3_press;
-              }
-
-              case 3:
-              {
-                return Mouse::btn_release;
-              }
-
-              default:
-              {
-                break;
-              }
-            }
+  // when the first unread byte arrived
+  Clock::time_point _since {};
 
-            return Mouse::null;
-          }
+  // the unread bytes are an incomplete sequence
+  bool _partial {false};
 
-          default:
-          {
-            return static_cast<char32_t>(key[0]);
-          }
-        }
-      }
+  bool _closed {false};
+}; // class Input
+
+// process-wide input decoder shared by all readers of stdin
+inline Input& input()
+{
+  static Input input;
+
+  return input;
+}
+
+inline bool wait_input(int timeout = -1)
+{
+  // wait until stdin is readable or timeout ms have passed,
+  // a negative timeout waits indefinitely,
+  // returns false on timeout, on a resize, when interrupted by a signal,
+  // or once the input is closed, see input_closed,
+  // returns true when buffered input is ready to be decoded
+
+  auto const pending = input().pending();
+
+  if (pending != -1 && (timeout < 0 || pending < timeout))
+  {
+    timeout = pending;
+  }
+
+  pollfd fds[2] {{STDIN_FILENO, POLLIN, 0}, {Winch::fd(), POLLIN, 0}};
+  int const ec = poll(&fds[0], Winch::fd() == -1 ? 1 : 2, timeout);
+
+  if (ec == -1)
+  {
+    if (errno == EINTR)
+    {
+      return false;
     }
+
+    throw std::runtime_error("poll failed");
+  }
+
+  if (fds[1].revents & POLLIN)
+  {
+    Winch::drain();
+  }
+
+  if (fds[0].revents & (POLLHUP | POLLERR | POLLNVAL))
+  {
+    input().close();
+
+    return false;
+  }
+
+  return (fds[0].revents & POLLIN) || (pending != -1 && input().pending() == 0);
+}
+
+inline bool input_closed()
+{
+  return input().closed();
+}
+
+inline bool input_ready()
+{
+  // check for input without waiting,
+  // a pending resize is left for the next wait_input,
+  // closed input also counts so the caller stops what it is doing
+
+  if (input().pending() == 0)
+  {
+    return true;
+  }
+
+  pollfd fd {STDIN_FILENO, POLLIN, 0};
+
+  if (poll(&fd, 1, 0) <= 0)
+  {
+    return false;
+  }
+
+  if (fd.revents & (POLLHUP | POLLERR | POLLNVAL))
+  {
+    input().close();
+
+    return true;
   }
 
-  return static_cast<char32_t>(key[0]);
+  return fd.revents & POLLIN;
+}
+
+inline char32_t get_key(std::string* str = nullptr)
+{
+  return input().get(str);
 }
 
 class Stdin
@@ -517,9 +723,10 @@ public:
 
   ~Mode()
   {
+    // a terminal that hung up can't be restored, and a destructor can't throw
     if (! _cooked)
     {
-      set_cooked();
+      tcsetattr(_stdin.fd(), TCSAFLUSH, &_old);
     }
   }
 
@@ -690,6 +897,43 @@ inline bool is_colorterm()
   return false;
 }
 
+namespace Depth
+{
+  enum value
+  {
+    bit4 = 4,
+    bit8 = 8,
+    bit24 = 24
+  };
+}
+
+inline Depth::value color_depth()
+{
+  // truecolor is only advertised through COLORTERM or a direct colour terminfo
+  // name, 256 colours through the terminfo name, anything else gets the
+  // 16 colour palette that every terminal understands
+  if (is_colorterm())
+  {
+    return Depth::bit24;
+  }
+
+  auto const term = env_var("TERM");
+
+  if (term.find("truecolor") != std::string::npos ||
+    term.find("24bit") != std::string::npos ||
+    term.find("direct") != std::string::npos)
+  {
+    return Depth::bit24;
+  }
+
+  if (term.find("256") != std::string::npos || ! env_var("COLORTERM").empty())
+  {
+    return Depth::bit8;
+  }
+
+  return Depth::bit4;
+}
+
 inline int width(std::size_t& width_, std::size_t fd_ = STDOUT_FILENO)
 {
   if (fd_ != STDIN_FILENO && fd_ != STDOUT_FILENO && fd_ != STDERR_FILENO)
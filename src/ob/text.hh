@@ -23,6 +23,7 @@
 #include <limits>
 #include <memory>
 #include <utility>
+#include <functional>
 #include <iterator>
 #include <algorithm>
 
@@ -1227,6 +1228,103 @@ public:
     return *this;
   }
 
+  // how a find ended
+  enum class Find
+  {
+    found,
+    none,
+    stopped,
+  };
+
+  // byte position in 'pos' of the first match starting in [begin, end),
+  // or of the last one when 'last' is set, without collecting the matches,
+  // 'stop' is polled every so often and ends the search when it returns true
+  static Find find(string_view rx, string_view str, size_type begin, size_type end,
+    bool const last, std::function<bool()> const& stop, size_type& pos)
+  {
+    UErrorCode ec = U_ZERO_ERROR;
+
+    std::unique_ptr<UText, decltype(&utext_close)> urx (
+      utext_openUTF8(nullptr, rx.data(), static_cast<std::int64_t>(rx.size()), &ec),
+      utext_close);
+
+    if (U_FAILURE(ec))
+    {
+      throw std::runtime_error("failed to create utext");
+    }
+
+    std::unique_ptr<UText, decltype(&utext_close)> ustr (
+      utext_openUTF8(nullptr, str.data(), static_cast<std::int64_t>(str.size()), &ec),
+      utext_close);
+
+    if (U_FAILURE(ec))
+    {
+      throw std::runtime_error("failed to create utext");
+    }
+
+    std::unique_ptr<regex> iter {new regex(urx.get(), UREGEX_CASE_INSENSITIVE, ec)};
+
+    if (! U_SUCCESS(ec))
+    {
+      throw std::runtime_error("failed to create regex matcher");
+    }
+
+    iter->reset(ustr.get());
+
+    Progress progress {stop};
+    iter->setFindProgressCallback(&Regex::progress, &progress, ec);
+
+    if (U_FAILURE(ec))
+    {
+      throw std::runtime_error("failed to set regex matcher callback");
+    }
+
+    Find res {Find::none};
+    bool found = iter->find(static_cast<std::int64_t>(begin), ec);
+
+    while (true)
+    {
+      if (ec == U_REGEX_STOPPED_BY_CALLER)
+      {
+        return Find::stopped;
+      }
+
+      if (U_FAILURE(ec))
+      {
+        throw std::runtime_error("failed to find regex match");
+      }
+
+      if (! found)
+      {
+        break;
+      }
+
+      auto const start = static_cast<size_type>(iter->start64(ec));
+
+      if (U_FAILURE(ec))
+      {
+        throw std::runtime_error("failed to get regex matcher start");
+      }
+
+      if (start >= end)
+      {
+        break;
+      }
+
+      pos = start;
+      res = Find::found;
+
+      if (! last)
+      {
+        break;
+      }
+
+      found = iter->find(ec);
+    }
+
+    return res;
+  }
+
   value_type const& get() const
   {
     return _str;
@@ -1313,6 +1411,25 @@ public:
 
 private:
 
+  struct Progress
+  {
+    std::function<bool()> const& stop;
+    std::size_t count {0};
+  };
+
+  // called as the search start moves, only checks 'stop' every so often
+  static UBool U_CALLCONV progress(void const* ctx, std::int64_t)
+  {
+    auto& progress = *static_cast<Progress*>(const_cast<void*>(ctx));
+
+    if (++progress.count % 16384 == 0 && progress.stop && progress.stop())
+    {
+      return false;
+    }
+
+    return true;
+  }
+
   value_type _str;
 }; // class Regex
 
@@ -56,7 +56,14 @@ public:
       update();
     }
 
-    return std::chrono::duration_cast<T>(_total);
+    return std::chrono::duration_cast<T>(_total.time_since_epoch());
+  }
+
+  void time(std::chrono::nanoseconds const val)
+  {
+    reset();
+    _total = std::chrono::time_point<std::chrono::high_resolution_clock>(
+      std::chrono::duration_cast<std::chrono::high_resolution_clock::duration>(val));
   }
 
   std::string str()
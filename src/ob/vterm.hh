@@ -0,0 +1,437 @@
+#ifndef OB_VTERM_HH
+#define OB_VTERM_HH
+
+#include <unicode/uchar.h>
+
+#include <cstddef>
+#include <cstdint>
+
+#include <string>
+#include <string_view>
+#include <vector>
+#include <algorithm>
+
+namespace OB
+{
+
+// in-memory virtual terminal of a fixed size
+// interprets the subset of escape sequences that the program writes,
+// so that frames can be rendered and inspected without a tty
+class VTerm
+{
+public:
+
+  struct Cell
+  {
+    // utf-8 encoded grapheme, empty for the trailing half of a wide char
+    std::string str {" "};
+
+    // active sgr parameters when the cell was written
+    std::string style;
+  };
+
+  VTerm(std::size_t const width, std::size_t const height) :
+    _width {width},
+    _height {height},
+    _cells (width * height)
+  {
+  }
+
+  std::size_t width() const
+  {
+    return _width;
+  }
+
+  std::size_t height() const
+  {
+    return _height;
+  }
+
+  Cell const& at(std::size_t const x, std::size_t const y) const
+  {
+    return _cells.at(y * _width + x);
+  }
+
+  // total bytes written to the terminal
+  std::size_t bytes() const
+  {
+    return _bytes;
+  }
+
+  VTerm& write(std::string_view const str)
+  {
+    _bytes += str.size();
+
+    for (std::size_t i = 0; i < str.size();)
+    {
+      auto const ch = static_cast<unsigned char>(str[i]);
+
+      if (ch == 0x1b)
+      {
+        i = escape(str, i + 1);
+      }
+      else if (ch == '\n')
+      {
+        // output post-processing maps nl to cr nl
+        _x = 0;
+        line_feed();
+        ++i;
+      }
+      else if (ch == '\r')
+      {
+        _x = 0;
+        ++i;
+      }
+      else if (ch < 0x20 || ch == 0x7f)
+      {
+        ++i;
+      }
+      else
+      {
+        std::size_t size {1};
+
+        if ((ch & 0xE0) == 0xC0)
+        {
+          size = 2;
+        }
+        else if ((ch & 0xF0) == 0xE0)
+        {
+          size = 3;
+        }
+        else if ((ch & 0xF8) == 0xF0)
+        {
+          size = 4;
+        }
+
+        put(str.substr(i, size));
+        i += size;
+      }
+    }
+
+    return *this;
+  }
+
+  // screen contents as text, one line per row
+  std::string str() const
+  {
+    std::string res;
+
+    for (std::size_t y = 0; y < _height; ++y)
+    {
+      for (std::size_t x = 0; x < _width; ++x)
+      {
+        res += at(x, y).str;
+      }
+
+      res += "\n";
+    }
+
+    return res;
+  }
+
+  // fnv-1a hash of the screen contents including styles
+  std::uint64_t hash() const
+  {
+    std::uint64_t res {0xcbf29ce484222325};
+
+    auto const add = [&](std::string const& str) {
+      for (auto const ch : str)
+      {
+        res ^= static_cast<unsigned char>(ch);
+        res *= 0x100000001b3;
+      }
+
+      res ^= 0xff;
+      res *= 0x100000001b3;
+    };
+
+    for (auto const& e : _cells)
+    {
+      add(e.str);
+      add(e.style);
+    }
+
+    return res;
+  }
+
+private:
+
+  void line_feed()
+  {
+    if (_y + 1 < _height)
+    {
+      ++_y;
+
+      return;
+    }
+
+    // scroll up one line
+    std::move(_cells.begin() + static_cast<std::ptrdiff_t>(_width), _cells.end(), _cells.begin());
+    std::fill(_cells.end() - static_cast<std::ptrdiff_t>(_width), _cells.end(), Cell());
+  }
+
+  void put(std::string_view const str)
+  {
+    std::int32_t cp {0};
+
+    switch (str.size())
+    {
+      case 1: cp = str[0]; break;
+      case 2: cp = ((str[0] & 0x1F) << 6) | (str[1] & 0x3F); break;
+      case 3: cp = ((str[0] & 0x0F) << 12) | ((str[1] & 0x3F) << 6) | (str[2] & 0x3F); break;
+      default: cp = ((str[0] & 0x07) << 18) | ((str[1] & 0x3F) << 12) | ((str[2] & 0x3F) << 6) | (str[3] & 0x3F); break;
+    }
+
+    // zero width code points join the previous cell
+    auto const category = u_charType(cp);
+
+    if (category == U_NON_SPACING_MARK || category == U_ENCLOSING_MARK ||
+      category == U_FORMAT_CHAR || (cp >= 0xFE00 && cp <= 0xFE0F))
+    {
+      if (_x > 0)
+      {
+        _cells.at(_y * _width + _x - 1).str += str;
+      }
+
+      return;
+    }
+
+    auto const ea = u_getIntPropertyValue(cp, UCHAR_EAST_ASIAN_WIDTH);
+    std::size_t const cols = (ea == U_EA_FULLWIDTH || ea == U_EA_WIDE) ? 2 : 1;
+
+    if (_x + cols > _width)
+    {
+      _x = 0;
+      line_feed();
+    }
+
+    auto& cell = _cells.at(_y * _width + _x);
+    cell.str = str;
+    cell.style = _style;
+
+    if (cols == 2)
+    {
+      auto& next = _cells.at(_y * _width + _x + 1);
+      next.str.clear();
+      next.style = _style;
+    }
+
+    _x += cols;
+
+    // stay on the last column until the next char is written
+    if (_x >= _width)
+    {
+      _x = _width - 1;
+    }
+  }
+
+  // parse the escape sequence starting after the esc byte,
+  // returns the index after the sequence
+  std::size_t escape(std::string_view const str, std::size_t i)
+  {
+    if (i >= str.size())
+    {
+      return i;
+    }
+
+    switch (str[i])
+    {
+      case '7':
+      {
+        _saved_x = _x;
+        _saved_y = _y;
+
+        return i + 1;
+      }
+
+      case '8':
+      {
+        _x = _saved_x;
+        _y = _saved_y;
+
+        return i + 1;
+      }
+
+      case 'c':
+      {
+        std::fill(_cells.begin(), _cells.end(), Cell());
+        _x = 0;
+        _y = 0;
+        _style.clear();
+
+        return i + 1;
+      }
+
+      case '[':
+      {
+        break;
+      }
+
+      default:
+      {
+        return i + 1;
+      }
+    }
+
+    // control sequence introducer
+    auto const begin = ++i;
+
+    while (i < str.size() && ! (str[i] >= 0x40 && str[i] <= 0x7E))
+    {
+      ++i;
+    }
+
+    if (i >= str.size())
+    {
+      return i;
+    }
+
+    csi(str.substr(begin, i - begin), str[i]);
+
+    return i + 1;
+  }
+
+  void csi(std::string_view const params, char const final)
+  {
+    // private modes such as cursor visibility and the alternate screen
+    if (! params.empty() && params[0] == '?')
+    {
+      return;
+    }
+
+    std::vector<std::size_t> args;
+    std::size_t val {0};
+    bool has_val {false};
+
+    for (auto const ch : params)
+    {
+      if (ch == ';')
+      {
+        args.emplace_back(has_val ? val : 0);
+        val = 0;
+        has_val = false;
+      }
+      else if (ch >= '0' && ch <= '9')
+      {
+        val = val * 10 + static_cast<std::size_t>(ch - '0');
+        has_val = true;
+      }
+    }
+
+    args.emplace_back(has_val ? val : 0);
+
+    auto const arg = [&](std::size_t const n, std::size_t const def) {
+      return n < args.size() && args.at(n) ? args.at(n) : def;
+    };
+
+    switch (final)
+    {
+      case 'H':
+      {
+        _y = std::min(arg(0, 1), _height) - 1;
+        _x = std::min(arg(1, 1), _width) - 1;
+
+        break;
+      }
+
+      case 'A':
+      {
+        _y -= std::min(arg(0, 1), _y);
+
+        break;
+      }
+
+      case 'B':
+      {
+        _y = std::min(_y + arg(0, 1), _height - 1);
+
+        break;
+      }
+
+      case 'C':
+      {
+        _x = std::min(_x + arg(0, 1), _width - 1);
+
+        break;
+      }
+
+      case 'D':
+      {
+        _x -= std::min(arg(0, 1), _x);
+
+        break;
+      }
+
+      case 'K':
+      {
+        auto const mode = args.at(0);
+        auto const row = _y * _width;
+        std::size_t const begin {mode == 0 ? _x : 0};
+        std::size_t const end {mode == 1 ? _x + 1 : _width};
+
+        for (auto x = begin; x < end; ++x)
+        {
+          _cells.at(row + x) = Cell();
+        }
+
+        break;
+      }
+
+      case 'J':
+      {
+        if (args.at(0) == 2)
+        {
+          std::fill(_cells.begin(), _cells.end(), Cell());
+        }
+
+        break;
+      }
+
+      case 'm':
+      {
+        if (params.empty() || params == "0")
+        {
+          _style.clear();
+        }
+        else
+        {
+          if (! _style.empty())
+          {
+            _style += ";";
+          }
+
+          _style += params;
+        }
+
+        break;
+      }
+
+      default:
+      {
+        break;
+      }
+    }
+  }
+
+  std::size_t _width {0};
+  std::size_t _height {0};
+  std::vector<Cell> _cells;
+
+  // cursor position, zero based
+  std::size_t _x {0};
+  std::size_t _y {0};
+
+  // saved cursor position
+  std::size_t _saved_x {0};
+  std::size_t _saved_y {0};
+
+  // active sgr parameters
+  std::string _style;
+
+  // total bytes written
+  std::size_t _bytes {0};
+}; // class VTerm
+
+} // namespace OB
+
+#endif // OB_VTERM_HH